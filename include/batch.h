@@ -0,0 +1,36 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef BATCH_H
+#define BATCH_H
+#include "gacha.h"
+
+// Simulation state of many accounts, with one array per field of GachaState_t
+// Every account must use the same RNG engine. The rarity roll and 3★ drops of xoshiro256** accounts are done 4 at a time with AVX2 when available.
+typedef struct {
+	unsigned int n; // Accounts in use, may be lowered after batchInit
+	unsigned int simd; // Set by batchInit if the CPU supports AVX2
+	unsigned int rngType;
+	unsigned char* pity[2];
+	unsigned char* pityS[4];
+	unsigned char* getRateUp[2];
+	unsigned char* fatePoints;
+	unsigned short* epitomizedPath;
+	unsigned long long* s[4];
+	unsigned long long* bits;
+	unsigned int* nbits;
+	// Scratch space for accounts that have to be finished one at a time
+	unsigned int* slow;
+	unsigned long long* slowFx;
+} Batch_t;
+
+int batchInit(Batch_t*, unsigned int);
+void batchFree(Batch_t*);
+// Copies a single account in or out of the batch. Words reserved with rngReserve aren't kept.
+void batchLoad(Batch_t*, unsigned int, const GachaState_t*);
+void batchStore(const Batch_t*, unsigned int, GachaState_t*);
+// Makes one wish on every account, exactly like doAWish would. The 4th argument is the wish number, starting at 0.
+void batchWish(Batch_t*, const GachaConfig_t*, const Session_t*, unsigned int, unsigned short*, unsigned char*, unsigned char*);
+#endif
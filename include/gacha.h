@@ -5,6 +5,8 @@
 
 #ifndef GACHA_H
 #define GACHA_H
+#include "util.h"
+
 // Banner types
 enum {
 	STD_CHR = 0,
@@ -43,23 +45,121 @@ extern const unsigned short FourStarWpn[18];
 extern const unsigned short FiveStarWpn[10];
 extern const unsigned char FourStarMaxIndex[IDX_MAX];
 extern const unsigned char FiveStarMaxIndex[IDX_MAX];
+int getBannerIndex(unsigned int, int);
+int getPoolIndex(unsigned int, int);
+
+// Simulation state of a single account
+// Aligned to a cache line so that states owned by different threads don't share one.
+typedef struct {
+	_Alignas(64) unsigned char pity[2];
+	unsigned char pityS[4];
+	unsigned char getRateUp[2];
+	unsigned char fatePoints;
+	unsigned short epitomizedPath;
+	Rng_t rng;
+} GachaState_t;
+
+// Mechanics that stay fixed during a run
+typedef struct {
+	int doSmooth[2];
+	int doPity[2];
+	int do5050;
+	int doEpitomized;
+	int doRadiance;
+} GachaConfig_t;
+
+// A banner with its pools and pity curves resolved, built once by prepareBanner
+#define POOL5_MAX 32
+#define POOL4_MAX 64
+#define POOL3_MAX 16
+struct PreparedBanner;
+// Everything after the rarity roll, specialized for one banner type
+typedef unsigned int PullKernel_t(GachaState_t*, const GachaConfig_t*, const struct PreparedBanner*, unsigned long long, unsigned int*, unsigned int*);
+typedef struct PreparedBanner {
+	unsigned int banner;
+	PullKernel_t* finish;
+	unsigned int stdPoolIndex;
+	unsigned int bannerIndex;
+	// Characters first, then weapons
+	unsigned short five[POOL5_MAX];
+	unsigned int fiveChrCnt;
+	unsigned int fiveWpnCnt;
+	unsigned short four[POOL4_MAX];
+	unsigned int fourChrCnt;
+	unsigned int fourWpnCnt;
+	unsigned short three[POOL3_MAX];
+	unsigned int threeCnt;
+	// Rate-up items
+	unsigned short fiveUp[2];
+	unsigned int fiveUpCnt;
+	unsigned short fourUp[5];
+	unsigned int fourUpCnt;
+	// Pity curves (as fixed-point thresholds, indexed by pity)
+	const unsigned long long* thrFive;
+	const unsigned long long* thrFour;
+	const unsigned long long* thrFourS;
+} PreparedBanner_t;
+
+// Banner selection and per-run options that sit outside doAPull itself
+typedef struct {
+	PreparedBanner_t pb;
+	unsigned int noviceCnt;
+	unsigned int forceSmooth;
+} Session_t;
 
-// Configuration variables
-extern unsigned char pity[2];
-extern unsigned char pityS[4];
-extern unsigned char getRateUp[2];
-extern unsigned char fatePoints;
-extern unsigned short epitomizedPath;
+void initGachaState(GachaState_t*);
+void initGachaConfig(GachaConfig_t*);
+void resolveGachaConfig(GachaConfig_t*, unsigned int, int);
+
+// State and configuration variables (used by the non-reentrant doAPull)
+extern GachaState_t gachaState;
 extern int doSmooth[2];
 extern int doPity[2];
 extern int do5050;
 extern int doEpitomized;
 extern int doRadiance;
+// Draw from gachaState.rng
+unsigned long long rndWord();
+long double rndFloat();
+
+// Pity curves
+long double getPullWeight(const GachaConfig_t*, unsigned int, unsigned int, unsigned int);
 
 // Main gacha function
 #ifndef DEBUG
+int prepareBanner(PreparedBanner_t*, unsigned int, unsigned int, unsigned int);
+#else
+int prepareBanner(PreparedBanner_t*, unsigned int, int, int);
+#endif
+// Switches the prepared banner to a kernel specialized for the given flags, if there's one
+void selectKernel(PreparedBanner_t*, const GachaConfig_t*);
+unsigned int doAPull_p(GachaState_t*, const GachaConfig_t*, const PreparedBanner_t*, unsigned int*, unsigned int*);
+// The two halves of doAPull_p, for callers that roll the rarity themselves (see batch.c)
+int getEpitomized(const GachaConfig_t*, const PreparedBanner_t*);
+void startPull_p(GachaState_t*, const GachaConfig_t*, const PreparedBanner_t*);
+unsigned int finishPull_p(GachaState_t*, const GachaConfig_t*, const PreparedBanner_t*, unsigned long long, unsigned int*, unsigned int*);
+#ifndef DEBUG
+unsigned int doAPull_r(GachaState_t*, const GachaConfig_t*, unsigned int, unsigned int, unsigned int, unsigned int*, unsigned int*);
 unsigned int doAPull(unsigned int, unsigned int, unsigned int, unsigned int*, unsigned int*);
 #else
+unsigned int doAPull_r(GachaState_t*, const GachaConfig_t*, unsigned int, int, int, unsigned int*, unsigned int*);
 unsigned int doAPull(unsigned int, int, int, unsigned int*, unsigned int*);
 #endif
+// Does a doAPull_r, handling the fixed Beginners' Wish drop and forced stable pity. The 4th argument is the wish number, starting at 0.
+unsigned int doAWish(GachaState_t*, const GachaConfig_t*, const Session_t*, unsigned int, unsigned int*, unsigned int*);
+
+// Result of one wish, with the counters as they were right after it
+typedef struct {
+	unsigned short item;
+	unsigned char rare;
+	unsigned char isRateUp;
+	unsigned char pity[2];
+	unsigned char fatePoints;
+} PullResult_t;
+// Makes 10 wishes with doAWish, starting at the given wish number, and fills the given array with the results
+void doTenPull(GachaState_t*, const GachaConfig_t*, const Session_t*, unsigned int, PullResult_t*);
+// Result of one wish packed in 21 bits: item id in bits 0-15, rarity in bits 16-18 and isRateUp in bits 19-20
+#define PULL_PACK(item, rare, isRateUp) (((item) & 0xffff) | ((rare) & 7) << 16 | ((isRateUp) & 3) << 19)
+// Makes the given amount of wishes with doAWish, starting at the given wish number, and writes them packed into the given array
+void doWishesPacked(GachaState_t*, const GachaConfig_t*, const Session_t*, unsigned int, unsigned int, unsigned int*);
 #endif
@@ -0,0 +1,16 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef HWPROF_H
+#define HWPROF_H
+
+// Hardware counters for --profile-hw, read through perf_event_open on Linux
+// Counters that can't be opened (no PMU, perf_event_paranoid, seccomp in containers...) are reported as unavailable and skipped.
+
+// Starts counting in the calling thread, and in the threads it creates from now on; gives the number of counters that could be opened
+int hwprofStart(void);
+// Stops counting and prints each counter divided by the number of pulls to stderr
+void hwprofStop(unsigned long long);
+#endif
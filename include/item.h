@@ -7,9 +7,12 @@
 #define ITEM_H
 // Characters
 const char* getCharacter(unsigned int);
+// Character names themselves are never translated; this also leaves Stella Fortuna names in English whatever the locale
+const char* getCharacterUntranslated(unsigned int);
 
 // Artifacts
 const char* getArtifact(unsigned int);
+const char* getArtifactUntranslated(unsigned int);
 
 // Weapons
 enum {
@@ -21,7 +24,10 @@ enum {
 };
 
 const char* getWeapon(unsigned int);
+const char* getWeaponUntranslated(unsigned int);
 
 // Other Items TODO
 const char* getItem(unsigned int);
+// Same as getItem, but with every name in English whatever the locale, for libyagiws
+const char* getItemUntranslated(unsigned int);
 #endif
@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef JOBS_H
+#define JOBS_H
+#include <pthread.h>
+#include <stdio.h>
+#include "gacha.h"
+
+// Jobs are read, run and written out this many at a time
+#define JOB_BATCH 256
+// Longest line, and most options on one line
+#define JOB_LINE_MAX 4096
+#define JOB_ARGS_MAX 64
+
+// One line of a --jobs file: a run resolved from its options, and what it ended up with
+typedef struct {
+	GachaState_t st;
+	GachaConfig_t cfg;
+	Session_t ses;
+	unsigned int line;
+	unsigned int pulls;
+	// Results
+	unsigned int firstFive; // Pull that gave the first 5★, or 0 if none did
+	unsigned int fives;
+	unsigned int rateUpFives;
+	unsigned int fours;
+} Job_t;
+
+// Worker threads that stay around for every batch of jobs
+typedef struct {
+	pthread_mutex_t lock;
+	pthread_cond_t work; // Signaled when a batch is posted or the pool is stopped
+	pthread_cond_t done; // Signaled when the last job of a batch is finished
+	Job_t* jobs;
+	unsigned int cnt;
+	unsigned int next;
+	unsigned int left;
+	unsigned int stop;
+	unsigned int threads;
+	pthread_t* thread;
+} JobPool_t;
+
+int jobPoolStart(JobPool_t*, unsigned int);
+// Runs the given jobs on the pool and waits for all of them
+void jobPoolRun(JobPool_t*, Job_t*, unsigned int);
+void jobPoolStop(JobPool_t*);
+
+// Writes the header, if the format has one. Only CSV and JSON lines are supported; other formats are written as CSV.
+void jobBegin(FILE*, unsigned int);
+void jobRecord(FILE*, unsigned int, const Job_t*);
+#endif
@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef MARKOV_H
+#define MARKOV_H
+#include "gacha.h"
+
+// Computes the exact distribution of the number of wishes needed for the k-th (3rd argument) targeted 5★.
+// The target is the Epitomized/Chronicled Path item if one is charted, otherwise any rate-up 5★, or any 5★ on banners without rate-ups.
+// dist[n] receives the chance of that happening on wish n, for n from 1 to the 4th argument. dist[0] is unused.
+// Returns the chance of it taking even longer, or a negative value on error.
+double getExactDist(const GachaState_t*, const GachaConfig_t*, const Session_t*, unsigned int, unsigned int, double*);
+#endif
@@ -0,0 +1,46 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef OUTPUT_H
+#define OUTPUT_H
+#include <stdio.h>
+
+// Output formats
+enum {
+	FMT_TEXT = 0,
+	FMT_CSV,
+	FMT_JSONL,
+	FMT_BIN,
+	FMT_CNT
+};
+extern const char* const formats[FMT_CNT][2];
+
+// One wish. Pity counters are the values after the wish.
+typedef struct {
+	unsigned int pull;
+	unsigned short item;
+	unsigned char rare;
+	unsigned char isRateUp;
+	unsigned char pity[2];
+	unsigned char fatePoints;
+} PullRecord_t;
+
+// Binary records are 8 bytes each, in pull order:
+// item id (16-bit little endian), rarity, rate-up flag, 4★ pity, 5★ pity, Fate Points, reserved (0)
+#define BIN_RECORD_SIZE 8
+
+#define OUT_BUF_SIZE (1 << 20)
+typedef struct {
+	FILE* f;
+	unsigned int format;
+	size_t len;
+	char buf[OUT_BUF_SIZE];
+} OutBuf_t;
+
+// Writes the header, if the format has one
+int outBegin(OutBuf_t*, FILE*, unsigned int);
+int outRecord(OutBuf_t*, const PullRecord_t*);
+int outFlush(OutBuf_t*);
+#endif
@@ -0,0 +1,28 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+// Protocol of --serve
+// A request is a single line of space-separated words, each either a key=value pair or a flag, named after the matching long option:
+//	banner=char1 banner_version=5.3.2 pulls=10 pity5=40 lostRateUp5
+// Accepted keys: banner, banner_version, pool_version, pulls, pity4, pity5, smooth4c, smooth4w, smooth5c, smooth5w, fate_points,
+// epitomized_path, noviceCnt, radiance, rng and seed. Accepted flags: lostRateUp4, lostRateUp5, noSmooth4, noSmooth5, noPity4,
+// noPity5, noGuarantee, rateUpOnly, forceSmoothChar, forceSmoothWpn, noSmoothOld, binary and names.
+// The reply starts with "OK <pulls>\n", followed by one "<pull>,<item>,<rarity>,<rate_up>\n" line per wish (with the item name
+// appended if names was given), or with binary, by one 32-bit little-endian YgPacked_t per wish. It ends with a line
+// "STATE <words>\n", where the words are the counters after the last wish in request form, so they can be sent back as is.
+// That includes epitomized_path, the index (starting at 1, as with -e) of the item charted on the Weapon Event or Chronicled Wish.
+// Bad requests get "ERR <reason>\n". A connection can send any amount of requests, and gets the replies in order.
+// Each thread serves one connection at a time. A connection is closed once it has sent nothing for SERVE_TIMEOUT seconds (even in the
+// middle of a line), or hasn't read any of its reply for as long, so that idle clients don't keep every thread to themselves.
+#define SERVE_TIMEOUT 30
+#define SERVE_LINE_MAX 1024
+#define SERVE_PULLS_MAX (1u << 24)
+
+// Serves requests on a Unix socket with the given amount of threads, each handling one connection at a time. Only returns on errors.
+int serve(const char*, unsigned int);
+#endif
@@ -0,0 +1,93 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef STATS_H
+#define STATS_H
+#include <time.h>
+#include "gacha.h"
+
+// Engine counters for --stats and phase latencies for --profile, only compiled in with ./configure --enable-stats
+// Without it, every STAT_* macro below expands to nothing (STAT_DRAW and PROF to their expression alone), so the engine is left as it was.
+
+// What a random word was drawn for
+enum {
+	DRAW_OTHER = 0,
+	DRAW_RARITY,
+	DRAW_RATE_UP, // 50/50, 75/25 and Epitomized/Chronicled Path rolls
+	DRAW_RADIANCE,
+	DRAW_STABLE, // Character/weapon split of stable pity
+	DRAW_POOL, // Item picks from a pool
+	DRAW_CNT
+};
+extern const char* const drawNames[DRAW_CNT];
+
+// Phases timed by --profile
+enum {
+	PHASE_RNG = 0, // Every random draw counted by STAT_DRAW
+	PHASE_DROP, // finishPull_p: pity thresholds, rate-up rolls and pool picks, draws included
+	PHASE_LOOKUP, // getItem
+	PHASE_RENDER, // Formatting a result
+	PHASE_WRITE, // Handing it to stdio
+	PHASE_CNT
+};
+extern const char* const phaseNames[PHASE_CNT];
+
+// Log-linear latency buckets: exact below 32, then 16 per power of 2, which keeps every bucket within 1/16 of its values
+#define LAT_SUB 16
+#define LAT_MAX_LOG 47
+#define LAT_BUCKETS ((LAT_MAX_LOG - 2) * LAT_SUB)
+
+// Only made of counters, which statsFlush relies on
+typedef struct {
+	unsigned long long words[DRAW_CNT];
+	unsigned long long getrandom;
+	// Pulls by the switch arm that made the drop, indexed by 5 - rarity and banner type
+	unsigned long long arms[3][WISH_CNT];
+	// 4★ and 5★ drops made past the base rate of their pity curve
+	unsigned long long softPity[2];
+	unsigned long long getItem;
+	// Latencies in profNow units, and their sums
+	unsigned long long lat[PHASE_CNT][LAT_BUCKETS];
+	unsigned long long latSum[PHASE_CNT];
+} Stats_t;
+
+#ifdef STATS
+// Counters of the calling thread, and what it's drawing random words for
+extern _Thread_local Stats_t stats;
+extern _Thread_local unsigned int statsDraw;
+#define STAT_INC(field) (stats.field++)
+#define STAT_ADD(field, n) (stats.field += (n))
+#define STAT_INC_IF(cond, field) do { if (cond) stats.field++; } while (0)
+extern int profiling;
+// TSC ticks where there is one, nanoseconds otherwise
+static inline unsigned long long profNow(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+void profAdd(unsigned int, unsigned long long);
+// Evaluates e, timing it as the given phase if --profile was given
+#define PROF(phase, e) __extension__ ({ unsigned long long profT_ = profiling ? profNow() : 0; __typeof__(e) profRet_ = (e); if (profiling) profAdd((phase), profNow() - profT_); profRet_; })
+// Evaluates e, counting the random words it draws as drawn for d
+#define STAT_DRAW(d, e) __extension__ ({ __typeof__(e) statsRet_; statsDraw = (d); statsRet_ = PROF(PHASE_RNG, e); statsDraw = DRAW_OTHER; statsRet_; })
+// Adds the counters of the calling thread to the totals; worker threads call this before they end
+void statsFlush(void);
+// Prints the totals to stderr, after flushing the calling thread
+void statsPrint(void);
+// Starts timing phases, and prints their latencies to stderr on exit
+void profStart(void);
+#else
+#define STAT_INC(field) ((void) 0)
+#define STAT_ADD(field, n) ((void) 0)
+#define STAT_INC_IF(cond, field) ((void) 0)
+#define STAT_DRAW(d, e) (e)
+#define PROF(phase, e) (e)
+#define statsFlush() ((void) 0)
+#endif
+#endif
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef SUMMARY_H
+#define SUMMARY_H
+#include <stdio.h>
+
+// Gaps and streaks this long or longer share the last bucket
+#define GAP_MAX 1024
+#define STREAK_MAX 64
+#define FATE_MAX 8
+
+// Aggregates over a run, updated after every wish
+typedef struct {
+	unsigned long long pulls;
+	unsigned long long rarity[6];
+	unsigned long long* items; // Indexed by item id
+	unsigned long long gap5[GAP_MAX + 1]; // Wishes between 5★ drops (or from the start of the run)
+	unsigned long long gap4[GAP_MAX + 1];
+	unsigned long long landed5[256]; // 5★ pity each 5★ dropped at
+	unsigned long long winStreak[STREAK_MAX + 1]; // Lengths of runs of won 50/50s
+	unsigned long long lossStreak[STREAK_MAX + 1];
+	unsigned long long radiance; // 50/50s won through Capturing Radiance
+	unsigned long long guaranteed; // 5★ drops that were guaranteed to be rate-up
+	unsigned long long fateAt[FATE_MAX + 1]; // Fate Points held when each 5★ dropped
+	unsigned long long fateUsed; // 5★ drops decided by Fate Points
+	// Running state
+	unsigned int hasRateUp;
+	unsigned int fateMax;
+	unsigned long long since5;
+	unsigned long long since4;
+	unsigned int streak;
+	unsigned int streakWon;
+} Summary_t;
+
+// The 2nd argument is whether the banner has a 50/50 (or 75/25), the 3rd the maximum amount of Fate Points (0 if not used).
+int summaryInit(Summary_t*, unsigned int, unsigned int);
+void summaryFree(Summary_t*);
+// Adds a wish. The last three arguments are the 5★ pity the wish was rolled at, and the 5★ guarantee and Fate Points from before the wish.
+void summaryAdd(Summary_t*, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int, unsigned int);
+void summaryPrint(Summary_t*, FILE*);
+#endif
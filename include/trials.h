@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef TRIALS_H
+#define TRIALS_H
+#include "gacha.h"
+
+// Histograms over many simulated accounts. Each array has pulls + 1 entries.
+typedef struct {
+	unsigned int pulls;
+	unsigned long long trials;
+	unsigned long long* firstFive; // Pulls until the first 5★. Index 0 counts accounts that got none.
+	unsigned long long* rateUpFive; // Number of rate-up 5★ obtained
+	unsigned long long* fourStars; // Number of 4★ obtained
+} TrialHist_t;
+
+// Simulates the given amount of accounts, starting at the given trial number, each starting from the given state and making the given amount of wishes.
+// Only the RNG of the given state is modified: one word is taken from it as the key for every trial's stream.
+// Trial n always uses stream n of that key, so the results don't depend on the thread count, and runs can be split into shards.
+int runTrials(GachaState_t*, const GachaConfig_t*, const Session_t*, unsigned int, unsigned long long, unsigned long long, unsigned int, TrialHist_t*);
+// Seeds the given state's RNG the same way runTrials seeds the given trial, so that it can be replayed by itself.
+void seedTrial(GachaState_t*, unsigned long long);
+void freeTrialHist(TrialHist_t*);
+#endif
@@ -10,6 +10,57 @@
 #define _(x) gettext(x)
 #define _N(x) gettext_noop(x)
 
-// RNG
-long double rndFloat();
+// RNG engines
+enum {
+	RNG_KERNEL = 0, // getrandom() on every draw
+	RNG_XOSHIRO, // xoshiro256**, seeded once
+	RNG_PHILOX, // Philox4x32-10, counter-based
+	RNG_CNT
+};
+extern const char* const rngNames[RNG_CNT][2];
+
+#define RNG_RESV 32
+typedef struct {
+	unsigned int type;
+	unsigned long long s[4];
+	// Reservoir of unused random bits for small decisions (see rndBits_r)
+	unsigned long long bits;
+	unsigned int nbits;
+	// Words drawn ahead of time by rngReserve, handed out before new ones
+	unsigned long long resv[RNG_RESV];
+	unsigned int resvPos;
+	unsigned int resvLen;
+} Rng_t;
+
+static inline unsigned long long rotl64(unsigned long long x, int k) {
+	return (x << k) | (x >> (64 - k));
+}
+
+// One xoshiro256** step on a bare state, shared with the batch kernels
+static inline unsigned long long xoshiroNext(unsigned long long* s) {
+	unsigned long long ret = rotl64(s[1] * 5, 7) * 9;
+	unsigned long long t = s[1] << 17;
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl64(s[3], 45);
+	return ret;
+}
+
+void rngSeed(Rng_t*, unsigned int, unsigned long long);
+// Seeds the generator to one of 2^64 streams of the given seed; see rngSeedStream() in util.c
+void rngSeedStream(Rng_t*, unsigned int, unsigned long long, unsigned long long);
+int rngInit(Rng_t*, unsigned int);
+void rngReserve(Rng_t*);
+unsigned long long rndWord_r(Rng_t*);
+long double rndFloat_r(Rng_t*);
+// Fixed-point counterpart of rndFloat_r, uniform in [0, RND_FIXED_ONE)
+#define RND_FIXED_ONE (1ull << 63)
+unsigned long long rndFixed_r(Rng_t*);
+// Uniform integer in [0, n), without modulo bias; n must be nonzero
+unsigned int rndBounded_r(Rng_t*, unsigned int);
+// Takes the next k (at most 32) bits from the reservoir, refilling it from a new word when needed
+unsigned int rndBits_r(Rng_t*, unsigned int);
 #endif
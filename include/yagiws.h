@@ -0,0 +1,122 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+// Public interface of libyagiws
+// The library never allocates memory and keeps no state of its own: every account lives in a YgAccount_t owned by the caller,
+// so different accounts can be used from different threads at the same time without locking.
+#ifndef YAGIWS_H
+#define YAGIWS_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Banner types, in the same order as the -b option of yagiws
+enum {
+	YG_STD_CHR = 0,
+	YG_STD_WPN,
+	YG_CHAR1,
+	YG_CHAR2,
+	YG_WPN,
+	YG_NOVICE,
+	YG_CHRONICLED,
+	YG_STD_ONLY_CHR,
+	YG_WISH_CNT
+};
+
+// RNG engines
+enum {
+	YG_RNG_KERNEL = 0,
+	YG_RNG_XOSHIRO,
+	YG_RNG_PHILOX,
+	YG_RNG_CNT
+};
+
+// Error codes returned by ygOpen
+enum {
+	YG_EBANNER = -1, // Unknown banner type, or the banner didn't run in the given version
+	YG_EVERSION = -2, // Banner version before 1.0, or invalid banner phase
+	YG_EPITY = -3, // Pity or Fate Points out of range
+	YG_EPATH = -4, // Invalid Epitomized Path index
+	YG_ERNG = -5, // Unknown RNG engine, or the kernel generator failed
+};
+
+// Everything needed to set up an account. ygDefaults fills it with the same defaults as yagiws uses.
+typedef struct {
+	unsigned int banner;
+	unsigned int version; // Banner version written as 0xMmp, e.g. 0x532 for v5.3 phase 2
+	unsigned int poolVersion; // Standard pool version written as 0xMm, or 0 to use the one of the banner
+	unsigned int rng;
+	unsigned int seeded; // Seed the generator with seed instead of the kernel (ignored by the kernel generator)
+	unsigned long long seed;
+	unsigned int pity[2]; // 4★ and 5★ pity
+	unsigned int pityS[4]; // Stable pity: 4★ characters, 4★ weapons, 5★ characters, 5★ weapons
+	unsigned int guaranteed[2]; // Next 4★ and 5★ are guaranteed to be rate-up items
+	unsigned int fatePoints;
+	unsigned int epitomizedPath; // Index of the charted item, starting at 1, or 0 for none
+	unsigned int noviceCnt; // Wishes already made on the Beginners' Wish
+	unsigned int forceSmooth; // 1 to force stable pity on characters, 2 on weapons
+	unsigned int oldSmooth;
+	// Same meaning as the fields of GachaConfig_t (see the matching yagiws options)
+	int doSmooth[2];
+	int doPity[2];
+	int do5050;
+	int doEpitomized;
+	int doRadiance;
+} YgOptions_t;
+
+// An account, opaque to the caller. It can be copied with memcpy to fork the account.
+#define YG_ACCOUNT_SIZE 1024
+typedef struct {
+	unsigned char opaque[YG_ACCOUNT_SIZE];
+} __attribute__((aligned(64))) YgAccount_t;
+
+// Result of one wish, with the counters as they were right after it
+typedef struct {
+	unsigned short item;
+	unsigned char rare;
+	unsigned char isRateUp;
+	unsigned char pity[2];
+	unsigned char fatePoints;
+} YgPull_t;
+
+// Result of one wish packed in 21 bits, for ygWishPacked
+typedef unsigned int YgPacked_t;
+#define YG_ITEM(p) ((p) & 0xffff)
+#define YG_RARE(p) ((p) >> 16 & 7)
+#define YG_RATEUP(p) ((p) >> 19 & 3) // 1 if the item is a rate-up item, 2 if it was given by Capturing Radiance
+
+// Counters of an account
+typedef struct {
+	unsigned char pity[2];
+	unsigned char pityS[4];
+	unsigned char guaranteed[2];
+	unsigned char fatePoints;
+	unsigned short epitomizedPath; // Id of the charted item, or 0
+	unsigned int wishNo; // Wishes made since ygOpen
+} YgState_t;
+
+const char* ygVersion(void);
+void ygDefaults(YgOptions_t*);
+// Resolves the banner and pools and seeds the generator. Returns 0 or one of the YG_E* codes.
+int ygOpen(YgAccount_t*, const YgOptions_t*);
+// Makes the given amount of wishes, filling one YgPull_t per wish
+void ygWish(YgAccount_t*, YgPull_t*, unsigned int);
+// Makes the given amount of wishes, writing one packed record per wish into the given array and,
+// unless the last argument is NULL, the counters after the last wish
+void ygWishPacked(YgAccount_t*, YgPacked_t*, unsigned int, YgState_t*);
+void ygGetState(const YgAccount_t*, YgState_t*);
+// Gives the items of a given rarity (3 to 5) that the account can get, characters first. Returns the amount of items.
+unsigned int ygPool(const YgAccount_t*, unsigned int, const unsigned short**, unsigned int*, unsigned int*);
+// Gives the rate-up items of a given rarity (4 or 5). Returns the amount of items.
+unsigned int ygRateUp(const YgAccount_t*, unsigned int, const unsigned short**);
+// Lookups by name or id. The returned strings are untranslated (item names included, whatever locale the caller set) and stay
+// valid until the next call on the same thread.
+int ygBannerType(const char*);
+const char* ygBannerName(unsigned int);
+const char* ygItemName(unsigned int);
+#ifdef __cplusplus
+}
+#endif
+#endif
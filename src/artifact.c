@@ -65,7 +65,7 @@ static const char* const Artifacts[100][6] = {
 	[99] = {_N("Lord of the Winds"), _N("Lord of Wind over Firmament's Cup"), _N("Lord of Wind over Firmament's Feather"), _N("Lord of Wind over Firmament's Crown"), _N("Lord of Wind over Firmament's Flower"), _N("Lord of Wind over Firmament's Hourglass")},
 };
 
-const char* getArtifact(unsigned int id) {
+const char* getArtifactUntranslated(unsigned int id) {
 	unsigned int set = id / 1000;
 	unsigned int rarity = (id % 1000) / 100;
 	unsigned int piece = (id % 100) / 10;
@@ -80,5 +80,10 @@ const char* getArtifact(unsigned int id) {
 	// As of v4.1, artifact IDs must be between 20 and 99.
 	if (set < 20) return NULL;
 	if (set > 99) return NULL;
-	return gettext(Artifacts[set][piece]);
+	return Artifacts[set][piece];
+}
+
+const char* getArtifact(unsigned int id) {
+	const char* ret = getArtifactUntranslated(id);
+	return ret != NULL ? gettext(ret) : NULL;
 }
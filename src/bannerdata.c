@@ -657,3 +657,67 @@ const unsigned short FourStarWpn[18] = {11401, 11402, 11403, 11405, 12401, 12402
 
 // The list of 5-star weapons in the pool, used together with the rate-up drops (only on the weapon and standard banners)
 const unsigned short FiveStarWpn[10] = {11501, 11502, 12501, 12502, 13502, 13505, 14501, 14502, 15501, 15502};
+
+// Turns a banner version written as 0xMmp (e.g. 0x532 for v5.3 phase 2) into an index into the rate-up tables
+int getBannerIndex(unsigned int banner, int ver) {
+	int v = ver >> 4;
+#ifndef DEBUG
+	if (v > 0x54) v = 0x54;
+#endif
+	if (v >= 0x50) {
+		v -= 0x7;
+	}
+	if (v >= 0x40) {
+		v -= 0x7;
+	}
+	if (v >= 0x30) {
+		v -= 0x7;
+	}
+	if (v >= 0x20) {
+		v -= 0x9;
+	}
+	if (v >= 0x14) {
+		v += 0x1;
+	}
+	v -= 0x10;
+#ifdef DEBUG
+	if (banner == CHRONICLED) {
+#else
+	(void) banner;
+	if (1) {
+#endif
+		if (v > IDX_MAX - 1) {
+			v = IDX_MAX - 1;
+		}
+	}
+	return (ver & 0xf) - 1 + (v << 1);
+}
+
+// Turns a standard pool version written as 0xMm into an index into FourStarMaxIndex and FiveStarMaxIndex
+int getPoolIndex(unsigned int banner, int ver) {
+	int v = ver;
+#ifndef DEBUG
+	if (banner == NOVICE) return 0;
+	if (v > 0x54) v = 0x54;
+#else
+	(void) banner;
+#endif
+	if (v >= 0x50) {
+		v -= 0x7;
+	}
+	if (v >= 0x40) {
+		v -= 0x7;
+	}
+	if (v >= 0x30) {
+		v -= 0x7;
+	}
+	if (v >= 0x20) {
+		v -= 0x9;
+	}
+	v -= 0xf;
+#ifndef DEBUG
+	if (v < 1) v = 1;
+	if (v > IDX_MAX) v = IDX_MAX;
+#endif
+	return v;
+}
@@ -0,0 +1,315 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include "gacha.h"
+#include "batch.h"
+#include "stats.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_AVX2 1
+#include <immintrin.h>
+#endif
+
+int batchInit(Batch_t* b, unsigned int n) {
+	unsigned int i;
+	int fail = 0;
+	memset(b, 0, sizeof(Batch_t));
+	b->n = n;
+	b->rngType = RNG_XOSHIRO;
+#ifdef BATCH_AVX2
+	b->simd = __builtin_cpu_supports("avx2") ? 1 : 0;
+#endif
+	for (i = 0; i < 2; i++) {
+		b->pity[i] = calloc(n, sizeof(unsigned char));
+		b->getRateUp[i] = calloc(n, sizeof(unsigned char));
+		fail |= b->pity[i] == NULL || b->getRateUp[i] == NULL;
+	}
+	for (i = 0; i < 4; i++) {
+		b->pityS[i] = calloc(n, sizeof(unsigned char));
+		b->s[i] = calloc(n, sizeof(unsigned long long));
+		fail |= b->pityS[i] == NULL || b->s[i] == NULL;
+	}
+	b->fatePoints = calloc(n, sizeof(unsigned char));
+	b->epitomizedPath = calloc(n, sizeof(unsigned short));
+	b->bits = calloc(n, sizeof(unsigned long long));
+	b->nbits = calloc(n, sizeof(unsigned int));
+	b->slow = calloc(n, sizeof(unsigned int));
+	b->slowFx = calloc(n, sizeof(unsigned long long));
+	fail |= b->fatePoints == NULL || b->epitomizedPath == NULL || b->bits == NULL || b->nbits == NULL || b->slow == NULL || b->slowFx == NULL;
+	if (fail) {
+		batchFree(b);
+		return -1;
+	}
+	return 0;
+}
+
+void batchFree(Batch_t* b) {
+	unsigned int i;
+	for (i = 0; i < 2; i++) {
+		free(b->pity[i]);
+		free(b->getRateUp[i]);
+	}
+	for (i = 0; i < 4; i++) {
+		free(b->pityS[i]);
+		free(b->s[i]);
+	}
+	free(b->fatePoints);
+	free(b->epitomizedPath);
+	free(b->bits);
+	free(b->nbits);
+	free(b->slow);
+	free(b->slowFx);
+	memset(b, 0, sizeof(Batch_t));
+}
+
+void batchLoad(Batch_t* b, unsigned int i, const GachaState_t* st) {
+	unsigned int j;
+	for (j = 0; j < 2; j++) {
+		b->pity[j][i] = st->pity[j];
+		b->getRateUp[j][i] = st->getRateUp[j];
+	}
+	for (j = 0; j < 4; j++) {
+		b->pityS[j][i] = st->pityS[j];
+		b->s[j][i] = st->rng.s[j];
+	}
+	b->fatePoints[i] = st->fatePoints;
+	b->epitomizedPath[i] = st->epitomizedPath;
+	b->rngType = st->rng.type;
+	b->bits[i] = st->rng.bits;
+	b->nbits[i] = st->rng.nbits;
+}
+
+void batchStore(const Batch_t* b, unsigned int i, GachaState_t* st) {
+	unsigned int j;
+	for (j = 0; j < 2; j++) {
+		st->pity[j] = b->pity[j][i];
+		st->getRateUp[j] = b->getRateUp[j][i];
+	}
+	for (j = 0; j < 4; j++) {
+		st->pityS[j] = b->pityS[j][i];
+		st->rng.s[j] = b->s[j][i];
+	}
+	st->fatePoints = b->fatePoints[i];
+	st->epitomizedPath = b->epitomizedPath[i];
+	st->rng.type = b->rngType;
+	st->rng.bits = b->bits[i];
+	st->rng.nbits = b->nbits[i];
+	st->rng.resvPos = 0;
+	st->rng.resvLen = 0;
+}
+
+// 4★ and 5★ drops are rare and branchy, so those accounts go through finishPull_p one at a time
+static void finishLane(Batch_t* b, const GachaConfig_t* cfg, const PreparedBanner_t* pb, unsigned int i, unsigned long long rndFx, unsigned short* item, unsigned char* rare, unsigned char* isRateUp) {
+	GachaState_t st;
+	unsigned int r, u;
+	batchStore(b, i, &st);
+	item[i] = finishPull_p(&st, cfg, pb, rndFx, &r, &u);
+	rare[i] = r;
+	isRateUp[i] = u;
+	batchLoad(b, i, &st);
+}
+
+// Rarity roll and 3★ drop of one xoshiro256** account
+// The 3★ pick is rndBounded_r; if it would need to reject, the account is finished the slow way instead.
+static void rollLane(Batch_t* b, const GachaConfig_t* cfg, const PreparedBanner_t* pb, unsigned int i, unsigned short* item, unsigned char* rare, unsigned char* isRateUp) {
+	unsigned long long s[4], t[4];
+	unsigned long long rndFx, m;
+	unsigned int j;
+	for (j = 0; j < 4; j++) {
+		s[j] = b->s[j][i];
+	}
+	rndFx = xoshiroNext(s) >> 1;
+	memcpy(t, s, sizeof(s));
+	m = (xoshiroNext(t) >> 32) * pb->threeCnt;
+	if (rndFx < pb->thrFive[cfg->doPity[1] ? b->pity[1][i] : 0] || rndFx < pb->thrFour[cfg->doPity[0] ? b->pity[0][i] : 0] || (unsigned int) m < pb->threeCnt) {
+		for (j = 0; j < 4; j++) {
+			b->s[j][i] = s[j];
+		}
+		finishLane(b, cfg, pb, i, rndFx, item, rare, isRateUp);
+		return;
+	}
+	for (j = 0; j < 4; j++) {
+		b->s[j][i] = t[j];
+	}
+	item[i] = pb->three[m >> 32];
+	rare[i] = 3;
+	isRateUp[i] = 0;
+	STAT_INC(words[DRAW_POOL]);
+	STAT_INC(arms[2][pb->banner]);
+}
+
+#ifdef BATCH_AVX2
+__attribute__((target("avx2"))) static inline __m256i xoshiroNext4(__m256i* s) {
+	__m256i x = _mm256_add_epi64(_mm256_slli_epi64(s[1], 2), s[1]);
+	__m256i ret = _mm256_or_si256(_mm256_slli_epi64(x, 7), _mm256_srli_epi64(x, 57));
+	__m256i t = _mm256_slli_epi64(s[1], 17);
+	ret = _mm256_add_epi64(_mm256_slli_epi64(ret, 3), ret);
+	s[2] = _mm256_xor_si256(s[2], s[0]);
+	s[3] = _mm256_xor_si256(s[3], s[1]);
+	s[1] = _mm256_xor_si256(s[1], s[2]);
+	s[0] = _mm256_xor_si256(s[0], s[3]);
+	s[2] = _mm256_xor_si256(s[2], t);
+	s[3] = _mm256_or_si256(_mm256_slli_epi64(s[3], 45), _mm256_srli_epi64(s[3], 19));
+	return ret;
+}
+
+// Lanes where rndFx < thr. The values are below 2^63 and the thresholds at most 2^63, so a signed compare against thr - 1 works.
+__attribute__((target("avx2"))) static inline __m256i below4(__m256i rndFx, const unsigned long long* tbl, int doPity, const unsigned char* pity) {
+	__m256i idx = _mm256_setzero_si256();
+	__m256i thr;
+	int p;
+	if (doPity) {
+		memcpy(&p, pity, sizeof(p));
+		idx = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(p));
+	}
+	thr = _mm256_i64gather_epi64((const long long*) tbl, idx, 8);
+	thr = _mm256_sub_epi64(thr, _mm256_set1_epi64x(1));
+	return _mm256_xor_si256(_mm256_cmpgt_epi64(rndFx, thr), _mm256_set1_epi64x(-1));
+}
+
+__attribute__((target("avx2"))) static unsigned int incAvx2(unsigned char* p, unsigned int n) {
+	unsigned int i;
+	for (i = 0; i + 32 <= n; i += 32) {
+		_mm256_storeu_si256((__m256i*) (p + i), _mm256_add_epi8(_mm256_loadu_si256((const __m256i*) (p + i)), _mm256_set1_epi8(1)));
+	}
+	return i;
+}
+
+// Same as rollLane, 4 accounts at a time. Returns the amount of accounts done.
+// Accounts that need finishPull_p are queued in b->slow and finished afterwards, so that this loop stays free of calls.
+__attribute__((target("avx2"))) static unsigned int rollAvx2(Batch_t* b, const GachaConfig_t* cfg, const PreparedBanner_t* pb, unsigned short* item, unsigned char* rare, unsigned char* isRateUp) {
+	__m256i s[4], t[4];
+	__m256i rndFx, slow, m;
+	const __m256i cnt = _mm256_set1_epi64x(pb->threeCnt);
+	// Local copies, since the byte stores below could otherwise alias them
+	const unsigned short* three = pb->three;
+	const unsigned long long* thrFive = pb->thrFive;
+	const unsigned long long* thrFour = pb->thrFour;
+	const int doPity4 = cfg->doPity[0], doPity5 = cfg->doPity[1];
+	unsigned long long* st[4] = {b->s[0], b->s[1], b->s[2], b->s[3]};
+	const unsigned char* pity4 = b->pity[0];
+	const unsigned char* pity5 = b->pity[1];
+	unsigned int* slowIdx = b->slow;
+	unsigned long long* slowFx = b->slowFx;
+	unsigned long long fx[4], idx[4];
+	unsigned int i, j, mask, n = b->n, slowCnt = 0;
+	for (i = 0; i + 4 <= n; i += 4) {
+		for (j = 0; j < 4; j++) {
+			s[j] = _mm256_loadu_si256((const __m256i*) (st[j] + i));
+		}
+		rndFx = _mm256_srli_epi64(xoshiroNext4(s), 1);
+		memcpy(t, s, sizeof(s));
+		m = _mm256_mul_epu32(_mm256_srli_epi64(xoshiroNext4(t), 32), cnt);
+		slow = _mm256_cmpgt_epi64(cnt, _mm256_and_si256(m, _mm256_set1_epi64x(0xffffffff)));
+		slow = _mm256_or_si256(slow, below4(rndFx, thrFive, doPity5, pity5 + i));
+		slow = _mm256_or_si256(slow, below4(rndFx, thrFour, doPity4, pity4 + i));
+		// 3★ lanes keep the state after both draws, the rest only after the first one
+		for (j = 0; j < 4; j++) {
+			_mm256_storeu_si256((__m256i*) (st[j] + i), _mm256_blendv_epi8(t[j], s[j], slow));
+		}
+		mask = _mm256_movemask_pd(_mm256_castsi256_pd(slow));
+		_mm256_storeu_si256((__m256i*) fx, rndFx);
+		_mm256_storeu_si256((__m256i*) idx, _mm256_srli_epi64(m, 32));
+		// Written for every lane; the slow ones are overwritten once finished
+		for (j = 0; j < 4; j++) {
+			item[i + j] = three[idx[j]];
+			rare[i + j] = 3;
+			isRateUp[i + j] = 0;
+		}
+		STAT_ADD(words[DRAW_POOL], 4 - __builtin_popcount(mask));
+		STAT_ADD(arms[2][pb->banner], 4 - __builtin_popcount(mask));
+		while (mask) {
+			j = __builtin_ctz(mask);
+			mask &= mask - 1;
+			slowIdx[slowCnt] = i + j;
+			slowFx[slowCnt] = fx[j];
+			slowCnt++;
+		}
+	}
+	for (j = 0; j < slowCnt; j++) {
+		finishLane(b, cfg, pb, slowIdx[j], slowFx[j], item, rare, isRateUp);
+	}
+	return i;
+}
+#endif
+
+static void incLanes(const Batch_t* b, unsigned char* p) {
+	unsigned int i = 0;
+#ifdef BATCH_AVX2
+	if (b->simd) i = incAvx2(p, b->n);
+#endif
+	for (; i < b->n; i++) {
+		p[i]++;
+	}
+}
+
+void batchWish(Batch_t* b, const GachaConfig_t* cfg, const Session_t* ses, unsigned int wishNo, unsigned short* item, unsigned char* rare, unsigned char* isRateUp) {
+	const PreparedBanner_t* pb = &ses->pb;
+	GachaState_t st;
+	unsigned int i = 0, j;
+	unsigned int r, u;
+	if (pb->banner == NOVICE && wishNo == (7 - ses->noviceCnt)) { // 8th wish is always Noelle on novice banner
+		for (i = 0; i < b->n; i++) {
+			item[i] = 1034;
+			rare[i] = 4;
+			isRateUp[i] = 0;
+			b->getRateUp[0][i] = 0;
+			b->pity[0][i] = 0;
+			b->pity[1][i]++;
+			b->pityS[0][i] = 0;
+			b->pityS[1][i] = 0;
+		}
+		return;
+	}
+	if (ses->forceSmooth & 1) {
+		memset(b->pityS[0], (unsigned char) ~1, b->n);
+		memset(b->pityS[2], (unsigned char) ~1, b->n);
+		memset(b->pityS[1], (unsigned char) -1, b->n);
+		memset(b->pityS[3], (unsigned char) -1, b->n);
+	}
+	if (ses->forceSmooth & 2) {
+		memset(b->pityS[1], (unsigned char) ~1, b->n);
+		memset(b->pityS[3], (unsigned char) ~1, b->n);
+		memset(b->pityS[0], (unsigned char) -1, b->n);
+		memset(b->pityS[2], (unsigned char) -1, b->n);
+	}
+	// Same as startPull_p, one counter at a time
+	for (j = 0; j < 2; j++) {
+		if (cfg->doPity[j]) incLanes(b, b->pity[j]);
+		if (cfg->doSmooth[j] > 0) {
+			incLanes(b, b->pityS[j * 2]);
+			incLanes(b, b->pityS[j * 2 + 1]);
+		}
+	}
+	if (cfg->do5050 <= 0) {
+		memset(b->getRateUp[0], cfg->do5050 < 0, b->n);
+		memset(b->getRateUp[1], cfg->do5050 < 0, b->n);
+	}
+	if (getEpitomized(cfg, pb) == 0) {
+		memset(b->fatePoints, 0, b->n);
+	}
+	if (b->rngType != RNG_XOSHIRO) {
+		for (i = 0; i < b->n; i++) {
+			batchStore(b, i, &st);
+			item[i] = finishPull_p(&st, cfg, pb, STAT_DRAW(DRAW_RARITY, rndFixed_r(&st.rng)), &r, &u);
+			rare[i] = r;
+			isRateUp[i] = u;
+			batchLoad(b, i, &st);
+		}
+		return;
+	}
+	// The rarity rolls below draw straight from the xoshiro256** states
+	STAT_ADD(words[DRAW_RARITY], b->n);
+	i = 0;
+#ifdef BATCH_AVX2
+	if (b->simd) i = rollAvx2(b, cfg, pb, item, rare, isRateUp);
+#endif
+	for (; i < b->n; i++) {
+		rollLane(b, cfg, pb, i, item, rare, isRateUp);
+	}
+}
@@ -0,0 +1,359 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+// Benchmarks for make bench
+// Every benchmark is repeated with twice the work until it runs for at least the minimum time, and the last run is reported.
+// Results are written to stdout, or the file given with -o, as a single JSON object:
+//	{"schema":1,"version":"...","machine":"...","min_time":0.5,"results":[
+//	{"group":"doAPull_p","name":"char1","unit":"pulls/s","value":...,"count":...,"seconds":...},
+//	...]}
+// Groups and names only ever get added, so results of different versions can be compared by (group, name).
+#include "config.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include "gacha.h"
+#include "item.h"
+#include "output.h"
+#include "util.h"
+
+#define BENCH_SCHEMA 1
+#define BENCH_VERSION 0x532
+#define BENCH_SEED 1
+
+static double minTime = 0.5;
+static FILE* out;
+static unsigned int results = 0;
+// Keeps the compiler from dropping the work being measured
+static volatile unsigned long long sink;
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Writes one result, and shows it on stderr as it comes in
+static void report(const char* group, const char* name, const char* unit, unsigned long long count, double secs) {
+	double value = secs > 0 ? count / secs : 0;
+	fprintf(out, "%s\n\t{\"group\":\"%s\",\"name\":\"%s\",\"unit\":\"%s\",\"value\":%.6g,\"count\":%llu,\"seconds\":%.6f}",
+		results ? "," : "", group, name, unit, value, count, secs);
+	fprintf(stderr, "%-10s %-14s %12.6g %s\n", group, name, value, unit);
+	results++;
+}
+
+// Runs fn with twice the count until it takes at least minTime (or the count would go past max), returning the time of the last run
+static double calibrate(double (*fn)(void*, unsigned long long), void* arg, unsigned long long start, unsigned long long max, unsigned long long* count) {
+	double secs;
+	for (*count = start; ; *count *= 2) {
+		secs = fn(arg, *count);
+		if (secs < 0 || secs >= minTime || *count > max / 2) break;
+	}
+	return secs;
+}
+
+// doAPull_p on a banner prepared once, which is the pull kernel alone
+static double benchPullPrepared(void* arg, unsigned long long n) {
+	unsigned int banner = *(const unsigned int*) arg;
+	unsigned int rare, isRateUp;
+	unsigned long long i, acc = 0;
+	double t;
+	GachaState_t st;
+	GachaConfig_t cfg;
+	PreparedBanner_t pb;
+	initGachaState(&st);
+	initGachaConfig(&cfg);
+	resolveGachaConfig(&cfg, banner, BENCH_VERSION);
+	if (prepareBanner(&pb, banner, getPoolIndex(banner, BENCH_VERSION >> 4), getBannerIndex(banner, BENCH_VERSION)) < 0) return -1;
+	selectKernel(&pb, &cfg);
+	rngSeed(&st.rng, RNG_XOSHIRO, BENCH_SEED);
+	t = now();
+	for (i = 0; i < n; i++) {
+		acc += doAPull_p(&st, &cfg, &pb, &rare, &isRateUp);
+	}
+	t = now() - t;
+	sink = acc;
+	return t;
+}
+
+// doAPull, using the globals like the original interface does
+static double benchPull(void* arg, unsigned long long n) {
+	unsigned int banner = *(const unsigned int*) arg;
+	int poolIdx = getPoolIndex(banner, BENCH_VERSION >> 4);
+	int bannerIdx = getBannerIndex(banner, BENCH_VERSION);
+	unsigned int rare, isRateUp;
+	unsigned long long i, acc = 0;
+	double t;
+	GachaConfig_t cfg;
+	initGachaConfig(&cfg);
+	resolveGachaConfig(&cfg, banner, BENCH_VERSION);
+	memcpy(doSmooth, cfg.doSmooth, sizeof(doSmooth));
+	memcpy(doPity, cfg.doPity, sizeof(doPity));
+	do5050 = cfg.do5050;
+	doEpitomized = cfg.doEpitomized;
+	doRadiance = cfg.doRadiance;
+	initGachaState(&gachaState);
+	rngSeed(&gachaState.rng, RNG_XOSHIRO, BENCH_SEED);
+	t = now();
+	for (i = 0; i < n; i++) {
+		acc += doAPull(banner, poolIdx, bannerIdx, &rare, &isRateUp);
+	}
+	t = now() - t;
+	sink = acc;
+	return t;
+}
+
+// doAWish on a prepared banner, as the command line and the library make wishes
+static double benchWish(void* arg, unsigned long long n) {
+	unsigned int banner = *(const unsigned int*) arg;
+	unsigned int rare, isRateUp;
+	unsigned long long i, acc = 0;
+	double t;
+	GachaState_t st;
+	GachaConfig_t cfg;
+	Session_t ses;
+	initGachaState(&st);
+	initGachaConfig(&cfg);
+	resolveGachaConfig(&cfg, banner, BENCH_VERSION);
+	memset(&ses, 0, sizeof(ses));
+	if (prepareBanner(&ses.pb, banner, getPoolIndex(banner, BENCH_VERSION >> 4), getBannerIndex(banner, BENCH_VERSION)) < 0) return -1;
+	selectKernel(&ses.pb, &cfg);
+	rngSeed(&st.rng, RNG_XOSHIRO, BENCH_SEED);
+	t = now();
+	for (i = 0; i < n; i++) {
+		acc += doAWish(&st, &cfg, &ses, i, &rare, &isRateUp);
+	}
+	t = now() - t;
+	sink = acc;
+	return t;
+}
+
+static double benchRng(void* arg, unsigned long long n) {
+	unsigned int type = *(const unsigned int*) arg;
+	unsigned long long i, acc = 0;
+	double t;
+	Rng_t r;
+	if (type == RNG_KERNEL) {
+		if (rngInit(&r, type) < 0) return -1;
+	}
+	else rngSeed(&r, type, BENCH_SEED);
+	t = now();
+	for (i = 0; i < n; i++) {
+		acc += rndWord_r(&r);
+	}
+	t = now() - t;
+	sink = acc;
+	return t;
+}
+
+// The ids that can come out of any banner, so that lookups hit the same tables as real output
+typedef struct {
+	unsigned short ids[WISH_CNT * (POOL5_MAX + POOL4_MAX + POOL3_MAX)];
+	unsigned int cnt;
+} ItemList_t;
+
+static double benchItem(void* arg, unsigned long long n) {
+	const ItemList_t* l = arg;
+	unsigned long long i, acc = 0;
+	unsigned int j = 0;
+	const char* s;
+	double t = now();
+	for (i = 0; i < n; i++) {
+		s = getItem(l->ids[j]);
+		acc += s != NULL ? (unsigned char) s[0] : 0;
+		if (++j == l->cnt) j = 0;
+	}
+	t = now() - t;
+	sink = acc;
+	return t;
+}
+
+typedef struct {
+	const char* path;
+	unsigned int format;
+	unsigned long long bytes;
+} CliRun_t;
+
+// Runs the program with its output going into a pipe that gets drained here, so writing out is part of the measurement
+static double benchCli(void* arg, unsigned long long n) {
+	CliRun_t* c = arg;
+	char buf[1 << 16];
+	char pulls[32];
+	char format[32];
+	char* argv[] = {(char*) c->path, "-b", "char1", "-p", pulls, "--seed=1", format, NULL};
+	int fds[2], status, null;
+	ssize_t len;
+	pid_t pid;
+	double t;
+	snprintf(pulls, sizeof(pulls), "%llu", n);
+	snprintf(format, sizeof(format), "--format=%s", formats[c->format][0]);
+	if (pipe(fds) < 0) return -1;
+	t = now();
+	pid = fork();
+	if (pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+	if (pid == 0) {
+		null = open("/dev/null", O_WRONLY);
+		dup2(fds[1], 1);
+		if (null >= 0) dup2(null, 2);
+		close(fds[0]);
+		close(fds[1]);
+		setenv("LC_ALL", "C", 1);
+		execv(c->path, argv);
+		_exit(127);
+	}
+	close(fds[1]);
+	c->bytes = 0;
+	while ((len = read(fds[0], buf, sizeof(buf))) != 0) {
+		if (len < 0) {
+			if (errno == EINTR) continue;
+			break;
+		}
+		c->bytes += len;
+	}
+	close(fds[0]);
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+	t = now() - t;
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+	return t;
+}
+
+static void usage(const char* prog) {
+	fprintf(stderr, "Usage: %s [-t SECONDS] [-o FILE] [YAGIWS]\n"
+		"Runs the benchmarks and writes the results to stdout as JSON.\n"
+		"\t-t SECONDS  Minimum time each benchmark runs for (default 0.5)\n"
+		"\t-o FILE     Write the results to FILE instead\n"
+		"\tYAGIWS      Path of the yagiws program, for the output benchmarks\n", prog);
+}
+
+int main(int argc, char** argv) {
+	struct utsname u;
+	PreparedBanner_t pb;
+	ItemList_t items;
+	CliRun_t cli;
+	unsigned long long count;
+	unsigned int i, j;
+	double secs;
+	const char* path = NULL;
+	char* p;
+	int c, ret = 0;
+	while ((c = getopt(argc, argv, "t:o:h")) != -1) {
+		switch (c) {
+		case 't':
+			minTime = strtod(optarg, &p);
+			if (p == optarg || *p != '\0' || minTime < 0) {
+				fprintf(stderr, "Invalid time \"%s\".\n", optarg);
+				return 1;
+			}
+			break;
+		case 'o':
+			path = optarg;
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (argc - optind > 1) {
+		usage(argv[0]);
+		return 1;
+	}
+	out = stdout;
+	if (path != NULL) {
+		out = fopen(path, "w");
+		if (out == NULL) {
+			fprintf(stderr, "Unable to open %s: %s\n", path, strerror(errno));
+			return 1;
+		}
+	}
+	if (uname(&u) < 0) strcpy(u.machine, "unknown");
+	fprintf(out, "{\"schema\":%d,\"version\":\"%s\",\"machine\":\"%s\",\"min_time\":%g,\"results\":[", BENCH_SCHEMA, PACKAGE_VERSION, u.machine, minTime);
+	for (i = 0; i < WISH_CNT; i++) {
+		secs = calibrate(benchPullPrepared, &i, 1024, 1ull << 40, &count);
+		if (secs < 0) {
+			fprintf(stderr, "Unable to prepare the %s banner.\n", banners[i][0]);
+			ret = 1;
+			continue;
+		}
+		report("doAPull_p", banners[i][0], "pulls/s", count, secs);
+	}
+	for (i = 0; i < WISH_CNT; i++) {
+		secs = calibrate(benchPull, &i, 1024, 1ull << 40, &count);
+		if (secs < 0) {
+			fprintf(stderr, "Unable to pull on the %s banner.\n", banners[i][0]);
+			ret = 1;
+			continue;
+		}
+		report("doAPull", banners[i][0], "pulls/s", count, secs);
+	}
+	for (i = 0; i < WISH_CNT; i++) {
+		secs = calibrate(benchWish, &i, 1024, 1ull << 40, &count);
+		if (secs < 0) {
+			fprintf(stderr, "Unable to prepare the %s banner.\n", banners[i][0]);
+			ret = 1;
+			continue;
+		}
+		report("doAWish", banners[i][0], "pulls/s", count, secs);
+	}
+	for (i = 0; i < RNG_CNT; i++) {
+		secs = calibrate(benchRng, &i, 1024, 1ull << 40, &count);
+		if (secs < 0) {
+			fprintf(stderr, "Unable to initialize the %s generator.\n", rngNames[i][0]);
+			ret = 1;
+			continue;
+		}
+		report("rng", rngNames[i][0], "words/s", count, secs);
+	}
+	items.cnt = 0;
+	for (i = 0; i < WISH_CNT; i++) {
+		if (prepareBanner(&pb, i, getPoolIndex(i, BENCH_VERSION >> 4), getBannerIndex(i, BENCH_VERSION)) < 0) continue;
+		for (j = 0; j < pb.fiveChrCnt + pb.fiveWpnCnt; j++) {
+			items.ids[items.cnt++] = pb.five[j];
+		}
+		for (j = 0; j < pb.fourChrCnt + pb.fourWpnCnt; j++) {
+			items.ids[items.cnt++] = pb.four[j];
+		}
+		for (j = 0; j < pb.threeCnt; j++) {
+			items.ids[items.cnt++] = pb.three[j];
+		}
+	}
+	if (items.cnt) {
+		secs = calibrate(benchItem, &items, 1024, 1ull << 40, &count);
+		report("getItem", "pools", "lookups/s", count, secs);
+	}
+	if (optind < argc) {
+		cli.path = argv[optind];
+		for (i = 0; i < FMT_CNT; i++) {
+			cli.format = i;
+			secs = calibrate(benchCli, &cli, 10000, UINT_MAX, &count);
+			if (secs < 0) {
+				fprintf(stderr, "Unable to run %s with --format=%s.\n", cli.path, formats[i][0]);
+				ret = 1;
+				continue;
+			}
+			report("cli", formats[i][0], "pulls/s", count, secs);
+			report("cli-output", formats[i][0], "bytes/s", cli.bytes, secs);
+		}
+	}
+	fprintf(out, "\n]}\n");
+	if (fclose(out) != 0) {
+		fprintf(stderr, "Unable to write the results: %s\n", strerror(errno));
+		return 1;
+	}
+	return ret;
+}
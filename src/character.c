@@ -109,29 +109,31 @@ static const char* const chrList[110] = {
 	[109] = _N("Yumemizuki Mizuki"),
 };
 
-const char* getCharacter(unsigned int id) {
-	static char stellaBuf[1024];
+// Character names are never translated here; Stella Fortuna names are, unless translate is 0
+static const char* characterName(unsigned int id, int translate) {
+	static _Thread_local char stellaBuf[1024];
+	const char* name;
 	if (id < 1000) return NULL;
 	if (id < 1100) {
 		return chrList[id - 1000];
 	}
-	if (id < 1200) {
-		if (chrList[id - 1100] == NULL) {
-			return NULL;
-		}
-		snprintf(stellaBuf, 1024, _("%s's Stella Fortuna"), gettext(chrList[id - 1100]));
-		return stellaBuf;
-	}
 	if (id >= 4100 && id <= 4109) {
 		return chrList[id - 4000];
 	}
-	if (id >= 5100 && id <= 5109) {
-		if (chrList[id - 5000] == NULL) {
-			return NULL;
-		}
-		snprintf(stellaBuf, 1024, _("%s's Stella Fortuna"), gettext(chrList[id - 5100]));
-		return stellaBuf;
-	}
+	if (id < 1200) name = chrList[id - 1100];
+	else if (id >= 5100 && id <= 5109) name = chrList[id - 5000];
 	// TODO handle avatar IDs (> 10000000)
-	return NULL;
+	else return NULL;
+	if (name == NULL) return NULL;
+	if (translate) snprintf(stellaBuf, 1024, _("%s's Stella Fortuna"), gettext(name));
+	else snprintf(stellaBuf, 1024, "%s's Stella Fortuna", name);
+	return stellaBuf;
+}
+
+const char* getCharacter(unsigned int id) {
+	return characterName(id, 1);
+}
+
+const char* getCharacterUntranslated(unsigned int id) {
+	return characterName(id, 0);
 }
@@ -5,15 +5,12 @@
 
 #include "config.h"
 #include <stddef.h>
-#include <sys/random.h>
+#include <string.h>
 #include "gacha.h"
+#include "stats.h"
 #include "util.h"
 
-unsigned char pity[2];
-unsigned char pityS[4];
-unsigned char getRateUp[2];
-unsigned char fatePoints;
-unsigned short epitomizedPath;
+GachaState_t gachaState = {.rng = {.type = RNG_KERNEL}};
 
 int doRadiance = 0;
 int doEpitomized = -1;
@@ -21,6 +18,55 @@ int doSmooth[2] = {1, 1};
 int doPity[2] = {1, 1};
 int do5050 = 1;
 
+void initGachaState(GachaState_t* st) {
+	unsigned int i;
+	st->pity[0] = 0;
+	st->pity[1] = 0;
+	for (i = 0; i < 4; i++) {
+		st->pityS[i] = 0;
+	}
+	st->getRateUp[0] = 0;
+	st->getRateUp[1] = 0;
+	st->fatePoints = 0;
+	st->epitomizedPath = 0;
+	st->rng = (Rng_t) {.type = RNG_KERNEL};
+}
+
+void initGachaConfig(GachaConfig_t* cfg) {
+	cfg->doSmooth[0] = 1;
+	cfg->doSmooth[1] = 1;
+	cfg->doPity[0] = 1;
+	cfg->doPity[1] = 1;
+	cfg->do5050 = 1;
+	cfg->doEpitomized = -1;
+	cfg->doRadiance = 0;
+}
+
+// Resolves the Epitomized Path and Capturing Radiance settings left on auto for a banner version written as 0xMmp
+void resolveGachaConfig(GachaConfig_t* cfg, unsigned int banner, int ver) {
+	if (cfg->doEpitomized < 0) {
+		// TODO Check the banner index instead
+		if (ver > 0x500 || banner == CHRONICLED) {
+			cfg->doEpitomized = 1;
+		}
+		else if ((ver < 0x200 && cfg->doEpitomized == -1) || banner != WPN) {
+			cfg->doEpitomized = 0;
+		}
+		else {
+			cfg->doEpitomized = 2;
+		}
+	}
+	if (cfg->doRadiance < 0) {
+		// TODO Check the banner index instead
+		if (ver > 0x500) {
+			cfg->doRadiance = 1;
+		}
+		else {
+			cfg->doRadiance = 0;
+		}
+	}
+}
+
 const char* const banners[WISH_CNT][2] = {
 	[CHAR1] = {"char1", _N("Character Event Wish")},
 	[CHAR2] = {"char2", _N("Character Event Wish-2")},
@@ -32,76 +78,183 @@ const char* const banners[WISH_CNT][2] = {
 	[CHRONICLED] = {"chronicle", _N("Chronicled Wish")}
 };
 
+// Pity curves, in ten-thousandths
 // TODO: There is a different linear rise for standard prior to reaching soft pity. Figure out what it is or if it even exists.
-static long double getWeight5(unsigned int _pity) {
-	if (_pity <= 73 || !doPity[1]) return 0.006l;
-	return 0.006l + 0.06l * (long double) (_pity - 73);
-}
+#define WEIGHT5(p) ((p) <= 73 ? 60 : 60 + 600 * ((p) - 73))
+#define WEIGHT4(p) ((p) <= 8 ? 510 : 510 + 5100 * ((p) - 8))
+#define WEIGHT5W(p) ((p) <= 62 ? 70 : (p) <= 73 ? 70 + 700 * ((p) - 62) : 7770 + 350 * ((p) - 73))
+#define WEIGHT4W(p) ((p) <= 7 ? 600 : (p) == 8 ? 6600 : 6600 + 3000 * ((p) - 8))
+#define WEIGHT3 9430
+#define WEIGHT3W 9330
 
-static long double getWeight4(unsigned int _pity) {
-	if (_pity <= 8 || !doPity[0]) return 0.051l;
-	return 0.051l + 0.51l * (long double) (_pity - 8);
-}
+// "Smoothening" function.
+// If it's disabled, it still needs to be called, since character vs weapon still needs to be decided; it's then a flat 50/50.
+// 5-star variant, only on standard banner
+#define WEIGHT5S(p) ((p) <= 146 ? 30 : 30 + 300 * ((p) - 146))
+// 4-star character/standard banner variant
+#define WEIGHT4S(p) ((p) <= 17 ? 255 : 255 + 2550 * ((p) - 17))
+// 4-star weapon banner variant
+#define WEIGHT4SW(p) ((p) <= 14 ? 300 : 300 + 3000 * ((p) - 14))
+#define WEIGHT_HALF 5000
 
-static long double getWeight5W(unsigned int _pity) {
-	if (_pity <= 62 || !doPity[1]) return 0.007l;
-	else if (_pity <= 73) return 0.007l + 0.07l * (long double) (_pity - 62);
-	return 0.777l + 0.035l * (long double) (_pity - 73);
-}
+// Converts a weight into a threshold to compare rndFixed_r against, i.e. floor(w / 10000 * 2^63), saturating at 2^63.
+// This is done in integer arithmetic so the tables are the same on every platform.
+#define THR(w) ((w) >= 10000 ? RND_FIXED_ONE : (unsigned long long) (w) * (RND_FIXED_ONE / 10000) + (unsigned long long) (w) * (RND_FIXED_ONE % 10000) / 10000)
+
+// Pity is stored in an unsigned char, so each curve is tabulated for all 256 values at build time.
+#define THR4(f, n) THR(f(n)), THR(f((n) + 1)), THR(f((n) + 2)), THR(f((n) + 3))
+#define THR16(f, n) THR4(f, n), THR4(f, (n) + 4), THR4(f, (n) + 8), THR4(f, (n) + 12)
+#define THR64(f, n) THR16(f, n), THR16(f, (n) + 16), THR16(f, (n) + 32), THR16(f, (n) + 48)
+#define THR256(f) {THR64(f, 0), THR64(f, 64), THR64(f, 128), THR64(f, 192)}
 
-static long double getWeight4W(unsigned int _pity) {
-	if (_pity <= 7 || !doPity[0]) return 0.06l;
-	else if (_pity == 8) return 0.66l;
-	return 0.66l + 0.3l * (long double) (_pity - 8);
+static const unsigned long long thr5[256] = THR256(WEIGHT5);
+static const unsigned long long thr4[256] = THR256(WEIGHT4);
+static const unsigned long long thr5W[256] = THR256(WEIGHT5W);
+static const unsigned long long thr4W[256] = THR256(WEIGHT4W);
+static const unsigned long long thr5S[256] = THR256(WEIGHT5S);
+static const unsigned long long thr4S[256] = THR256(WEIGHT4S);
+static const unsigned long long thr4SW[256] = THR256(WEIGHT4SW);
+
+// With pity disabled, the chance stays at the base rate, which is the first entry of each curve.
+static inline unsigned long long pityThr(const unsigned long long* tbl, int doPity, unsigned int _pity) {
+	return tbl[doPity ? _pity : 0];
 }
 
-static long double getWeight(unsigned int _pity, unsigned int rare) {
-	switch (rare) {
-	default:
-		return 0.0f;
-	case 3:
-		return 0.943l;
-	case 4:
-		return getWeight4(_pity);
-	case 5:
-		return getWeight5(_pity);
-	}
+static inline unsigned long long smoothThr(const unsigned long long* tbl, int doSmooth, unsigned int _pity) {
+	return doSmooth ? tbl[_pity] : THR(WEIGHT_HALF);
 }
 
-static long double getWeightW(unsigned int _pity, unsigned int rare) {
+// Chance of getting an item of the given rarity (or better) at the given pity, exactly as used by doAPull_r
+long double getPullWeight(const GachaConfig_t* cfg, unsigned int banner, unsigned int _pity, unsigned int rare) {
+	unsigned int isWpn = banner == WPN || banner == STD_WPN;
+	unsigned long long thr;
+	_pity &= 0xff;
 	switch (rare) {
 	default:
-		return 0.0f;
+		thr = 0;
+		break;
 	case 3:
-		return 0.933l;
+		thr = isWpn ? THR(WEIGHT3W) : THR(WEIGHT3);
+		break;
 	case 4:
-		return getWeight4W(_pity);
+		thr = pityThr(isWpn ? thr4W : thr4, cfg->doPity[0], _pity);
+		break;
 	case 5:
-		return getWeight5W(_pity);
+		thr = pityThr(isWpn ? thr5W : thr5, cfg->doPity[1], _pity);
+		break;
 	}
+	return (long double) thr / (long double) RND_FIXED_ONE;
 }
 
-// "Smoothening" function.
-// If it's disabled, it still needs to be called, since character vs weapon still needs to be decided.
-// 5-star variant, only on standard banner
-static long double getWeight5S(unsigned int _pity) {
-	if (!doSmooth[1]) return 0.5f;
-	if (_pity <= 146) return 0.003l;
-	return 0.003l + 0.03l * (long double) (_pity - 146);
+static unsigned int copyPool(unsigned short* dst, const unsigned short* src, unsigned int cnt) {
+	memcpy(dst, src, cnt * sizeof(unsigned short));
+	return cnt;
 }
 
-// 4-star character/standard banner variant
-static long double getWeight4S(unsigned int _pity) {
-	if (!doSmooth[0]) return 0.5f;
-	if (_pity <= 17) return 0.0255l;
-	return 0.0255l + 0.255l * (long double) (_pity - 17);
-}
+// Flag sets with kernels of their own, for the usual command lines: no options, -n -N, -s -S, -r and -s -S --noSmoothOld.
+// Only doSmooth, doPity and do5050 are pinned. The Fate Point and Capturing Radiance defaults depend on the banner version, so those are still read from the configuration.
+enum {
+	FLAGS_GENERIC = 0,
+	FLAGS_DEFAULT,
+	FLAGS_NO_PITY,
+	FLAGS_NO_SMOOTH,
+	FLAGS_RATE_UP,
+	FLAGS_OLD_SMOOTH,
+	FLAGS_CNT
+};
+static const GachaConfig_t flagSets[FLAGS_CNT] = {
+	[FLAGS_DEFAULT] = {.doSmooth = {1, 1}, .doPity = {1, 1}, .do5050 = 1},
+	[FLAGS_NO_PITY] = {.doSmooth = {1, 1}, .doPity = {0, 0}, .do5050 = 1},
+	[FLAGS_NO_SMOOTH] = {.doSmooth = {0, 0}, .doPity = {1, 1}, .do5050 = 1},
+	[FLAGS_RATE_UP] = {.doSmooth = {1, 1}, .doPity = {1, 1}, .do5050 = -1},
+	[FLAGS_OLD_SMOOTH] = {.doSmooth = {-1, -1}, .doPity = {1, 1}, .do5050 = 1},
+};
 
-// 4-star weapon banner variant
-static long double getWeight4SW(unsigned int _pity) {
-	if (!doSmooth[0]) return 0.5f;
-	if (_pity <= 14) return 0.03l;
-	return 0.03l + 0.3l * (long double) (_pity - 14);
+// Defined after the pull kernels
+static PullKernel_t* const pullKernels[FLAGS_CNT][WISH_CNT];
+
+#ifndef DEBUG
+int prepareBanner(PreparedBanner_t* pb, unsigned int banner, unsigned int stdPoolIndex, unsigned int bannerIndex) {
+#else
+int prepareBanner(PreparedBanner_t* pb, unsigned int banner, int stdPoolIndex, int bannerIndex) {
+#endif
+	const ChroniclePool_t* ChroniclePool = NULL;
+	if (pb == NULL) return -1;
+	if (banner >= WISH_CNT) return -1;
+#ifndef DEBUG
+	if (stdPoolIndex >= IDX_MAX) return -1;
+	if (bannerIndex >= IDX_MAX * 2) return -1;
+#endif
+	if (banner == CHRONICLED) {
+		ChroniclePool = getChroniclePool(bannerIndex);
+		if (ChroniclePool == NULL) return -1;
+#ifndef DEBUG
+		if (ChroniclePool->FiveStarCharCount + ChroniclePool->FiveStarWeaponCount > POOL5_MAX) return -1;
+		if (ChroniclePool->FourStarCharCount + ChroniclePool->FourStarWeaponCount > POOL4_MAX) return -1;
+#endif
+	}
+	memset(pb, 0, sizeof(PreparedBanner_t));
+	pb->banner = banner;
+	pb->stdPoolIndex = stdPoolIndex;
+	pb->bannerIndex = bannerIndex;
+	pb->finish = pullKernels[FLAGS_GENERIC][banner]; // Until selectKernel is called
+	pb->thrFive = thr5;
+	pb->thrFour = thr4;
+	pb->thrFourS = thr4S;
+	if (banner == WPN || banner == STD_WPN) {
+		pb->thrFive = thr5W;
+		pb->thrFour = thr4W;
+		pb->thrFourS = thr4SW;
+	}
+	pb->threeCnt = copyPool(pb->three, ThreeStar, 13);
+	// Characters come first in each pool, followed by weapons.
+	// Event banners leave out the three 4-star characters that only appear in the standard banner.
+	switch (banner) {
+	case CHAR1:
+	case CHAR2:
+		pb->fiveUp[0] = FiveStarChrUp[bannerIndex][banner - CHAR1];
+		pb->fiveUpCnt = 1;
+		pb->fiveChrCnt = copyPool(pb->five, FiveStarChr, FiveStarMaxIndex[stdPoolIndex]);
+		pb->fourUpCnt = copyPool(pb->fourUp, FourStarChrUp[bannerIndex], 3);
+		pb->fourChrCnt = copyPool(pb->four, FourStarChr + 3, FourStarMaxIndex[stdPoolIndex]);
+		pb->fourWpnCnt = copyPool(pb->four + pb->fourChrCnt, FourStarWpn, 18);
+		break;
+	case WPN:
+		pb->fiveUpCnt = copyPool(pb->fiveUp, FiveStarWpnUp[bannerIndex], 2);
+		pb->fiveWpnCnt = copyPool(pb->five, FiveStarWpn, 10);
+		pb->fourUpCnt = copyPool(pb->fourUp, FourStarWpnUp[bannerIndex], 5);
+		pb->fourChrCnt = copyPool(pb->four, FourStarChr + 3, FourStarMaxIndex[stdPoolIndex]);
+		pb->fourWpnCnt = copyPool(pb->four + pb->fourChrCnt, FourStarWpn, 18);
+		break;
+	case CHRONICLED:
+		pb->fiveChrCnt = copyPool(pb->five, ChroniclePool->FiveStarPool, ChroniclePool->FiveStarCharCount);
+		pb->fiveWpnCnt = copyPool(pb->five + pb->fiveChrCnt, ChroniclePool->FiveStarPool + pb->fiveChrCnt, ChroniclePool->FiveStarWeaponCount);
+		pb->fourChrCnt = copyPool(pb->four, ChroniclePool->FourStarPool, ChroniclePool->FourStarCharCount);
+		pb->fourWpnCnt = copyPool(pb->four + pb->fourChrCnt, ChroniclePool->FourStarPool + pb->fourChrCnt, ChroniclePool->FourStarWeaponCount);
+		break;
+	case NOVICE:
+		pb->fiveChrCnt = copyPool(pb->five, FiveStarChr, FiveStarMaxIndex[stdPoolIndex]);
+		pb->fourChrCnt = copyPool(pb->four, FourStarChr + 3, FourStarMaxIndex[stdPoolIndex]);
+		break;
+	case STD_WPN:
+		pb->fiveWpnCnt = copyPool(pb->five, FiveStarWpn, 10);
+		pb->fourChrCnt = copyPool(pb->four, FourStarChr, FourStarMaxIndex[stdPoolIndex] + 3);
+		pb->fourWpnCnt = copyPool(pb->four + pb->fourChrCnt, FourStarWpn, 18);
+		break;
+	case STD_ONLY_CHR:
+		pb->fiveChrCnt = copyPool(pb->five, FiveStarChr, FiveStarMaxIndex[stdPoolIndex]);
+		pb->fourChrCnt = copyPool(pb->four, FourStarChr, FourStarMaxIndex[stdPoolIndex] + 3);
+		pb->fourWpnCnt = copyPool(pb->four + pb->fourChrCnt, FourStarWpn, 18);
+		break;
+	case STD_CHR:
+	default:
+		pb->fiveChrCnt = copyPool(pb->five, FiveStarChr, FiveStarMaxIndex[stdPoolIndex]);
+		pb->fiveWpnCnt = copyPool(pb->five + pb->fiveChrCnt, FiveStarWpn, 10);
+		pb->fourChrCnt = copyPool(pb->four, FourStarChr, FourStarMaxIndex[stdPoolIndex] + 3);
+		pb->fourWpnCnt = copyPool(pb->four + pb->fourChrCnt, FourStarWpn, 18);
+		break;
+	}
+	return 0;
 }
 
 /*
@@ -112,483 +265,621 @@ In the future, this should be handled by either:
 	1) treating this as actually a event-rate win, or
 	2) rerolling.
 */
-// TODO Ignoring getrandom's return value should not really be done.
-#ifndef DEBUG
-unsigned int doAPull(unsigned int banner, unsigned int stdPoolIndex, unsigned int bannerIndex, unsigned int* rare, unsigned int* isRateUp) {
-#else
-unsigned int doAPull(unsigned int banner, int stdPoolIndex, int bannerIndex, unsigned int* rare, unsigned int* isRateUp) {
-#endif
-	unsigned long long rnd;
-	long double rndF;
-	unsigned int maxIdx;
-	unsigned int minIdx;
-	const unsigned short* pool;
-	const ChroniclePool_t* ChroniclePool = getChroniclePool(bannerIndex);
-	if (banner >= WISH_CNT) return -1;
-	if (rare == NULL) return -1;
-	if (isRateUp == NULL) return -1;
-	long double (*_getWeight)(unsigned int, unsigned int) = getWeight;
-	if (banner == WPN || banner == STD_WPN) _getWeight = getWeightW;
-	if (doPity[0]) pity[0]++;
-	if (doPity[1]) pity[1]++;
-	if (doSmooth[0] > 0) {
-		pityS[0]++;
-		pityS[1]++;
+// Maximum Fate Points, resolving the banner default
+static inline int epitomizedFor(const GachaConfig_t* cfg, unsigned int banner) {
+	if (cfg->doEpitomized < 0) {
+		// TODO: Check banner version index
+		return banner == CHRONICLED ? 1 : 2;
 	}
-	if (doSmooth[1] > 0) {
-		pityS[2]++;
-		pityS[3]++;
+	return cfg->doEpitomized;
+}
+
+int getEpitomized(const GachaConfig_t* cfg, const PreparedBanner_t* pb) {
+	return epitomizedFor(cfg, pb->banner);
+}
+
+// Counter updates done before the rarity roll
+void startPull_p(GachaState_t* st, const GachaConfig_t* cfg, const PreparedBanner_t* pb) {
+	if (cfg->doPity[0]) st->pity[0]++;
+	if (cfg->doPity[1]) st->pity[1]++;
+	if (cfg->doSmooth[0] > 0) {
+		st->pityS[0]++;
+		st->pityS[1]++;
 	}
-	if (do5050 == 0) {
-		getRateUp[0] = 0;
-		getRateUp[1] = 0;
+	if (cfg->doSmooth[1] > 0) {
+		st->pityS[2]++;
+		st->pityS[3]++;
 	}
-	else if (do5050 < 0) {
-		getRateUp[0] = 1;
-		getRateUp[1] = 1;
+	if (cfg->do5050 == 0) {
+		st->getRateUp[0] = 0;
+		st->getRateUp[1] = 0;
 	}
-	if (doRadiance < 0) {
-		// TODO: Check banner version index
-		doRadiance = 0;
+	else if (cfg->do5050 < 0) {
+		st->getRateUp[0] = 1;
+		st->getRateUp[1] = 1;
 	}
-	if (doEpitomized < 0) {
-		// TODO: Check banner version index
-		doRadiance = banner == CHRONICLED ? 1 : 2;
+	if (getEpitomized(cfg, pb) == 0) {
+		st->fatePoints = 0;
 	}
-	if (doEpitomized == 0) {
-		fatePoints = 0;
+}
+
+// Arguments are not checked here; that's done once by prepareBanner.
+unsigned int doAPull_p(GachaState_t* st, const GachaConfig_t* cfg, const PreparedBanner_t* pb, unsigned int* rare, unsigned int* isRateUp) {
+	unsigned long long rndFx;
+	startPull_p(st, cfg, pb);
+	rndFx = STAT_DRAW(DRAW_RARITY, rndFixed_r(&st->rng));
+	return PROF(PHASE_DROP, finishPull_p(st, cfg, pb, rndFx, rare, isRateUp));
+}
+
+// Everything after the rarity roll, given the rolled value, through the banner's own kernel
+unsigned int finishPull_p(GachaState_t* st, const GachaConfig_t* cfg, const PreparedBanner_t* pb, unsigned long long rndFx, unsigned int* rare, unsigned int* isRateUp) {
+	return pb->finish(st, cfg, pb, rndFx, rare, isRateUp);
+}
+
+// Item pick from a pool, counted as such by --stats
+static inline unsigned int pickFrom(Rng_t* r, unsigned int n) {
+	return STAT_DRAW(DRAW_POOL, rndBounded_r(r, n));
+}
+
+// startPull_p already forced the guarantee if the 50/50 is disabled either way
+static inline int guaranteed(const GachaConfig_t* fl, const GachaState_t* st, unsigned int i) {
+	if (fl->do5050 < 0) return 1;
+	if (fl->do5050 == 0) return 0;
+	return st->getRateUp[i];
+}
+
+// Template for the pull kernels below. It's always inlined with a constant banner type and flag set, so each kernel only keeps the branches it can take.
+static inline __attribute__((always_inline)) unsigned int finishPullT(GachaState_t* st, const GachaConfig_t* cfg, const PreparedBanner_t* pb, unsigned long long rndFx, unsigned int* rare, unsigned int* isRateUp, const unsigned int banner, const unsigned int flags) {
+	const GachaConfig_t* fl = flags == FLAGS_GENERIC ? cfg : &flagSets[flags];
+	unsigned long long rnd;
+	unsigned int maxIdx;
+	unsigned int minIdx;
+	const unsigned short* pool;
+	int radiance;
+	int epitomized;
+	radiance = cfg->doRadiance;
+	if (radiance < 0) {
+		// TODO: Check banner version index
+		radiance = 0;
 	}
-	rndF = rndFloat();
-	if (rndF <= _getWeight(pity[1], 5)) {
+	epitomized = epitomizedFor(cfg, banner);
+	if (rndFx < pityThr(pb->thrFive, fl->doPity[1], st->pity[1])) {
 		*rare = 5;
-		pity[1] = 0;
+		STAT_INC(arms[0][pb->banner]);
+		STAT_INC_IF(pityThr(pb->thrFive, fl->doPity[1], st->pity[1]) > pb->thrFive[0], softPity[1]);
+		st->pity[1] = 0;
 		switch (banner) {
 		case CHAR1:
 		case CHAR2:
 			// Character banners don't use the stable function for 5-stars
-			pityS[2] = 0;
-			pityS[3] = 0;
-			if (!getRateUp[1]) {
-				getrandom(&rnd, sizeof(long long), 0);
+			st->pityS[2] = 0;
+			st->pityS[3] = 0;
+			if (!guaranteed(fl, st, 1)) {
+				rnd = STAT_DRAW(DRAW_RATE_UP, rndBits_r(&st->rng, 1));
 			}
 			else rnd = 0;
-			if (rnd % 2 == 0) {
+			if (rnd == 0) {
 				*isRateUp = 1;
-				getRateUp[1] = 0;
+				st->getRateUp[1] = 0;
 				// Character banners don't use Fate Points, but best to reset them anyway
-				fatePoints = 0;
-				return FiveStarChrUp[bannerIndex][banner - CHAR1];
+				st->fatePoints = 0;
+				return pb->fiveUp[0];
 			}
-			if (doRadiance) {
-				getrandom(&rnd, sizeof(long long), 0);
-				if (rnd % 10 == 0) {
+			if (radiance) {
+				// 4 bits at a time, rejecting 10-15 to keep this a 1 in 10 chance
+				do {
+					rnd = STAT_DRAW(DRAW_RADIANCE, rndBits_r(&st->rng, 4));
+				} while (rnd >= 10);
+				if (rnd == 0) {
 					*isRateUp = 2;
-					getRateUp[1] = 0;
+					st->getRateUp[1] = 0;
 					// Character banners don't use Fate Points, but best to reset them anyway
-					fatePoints = 0;
-					return FiveStarChrUp[bannerIndex][banner - CHAR1];
+					st->fatePoints = 0;
+					return pb->fiveUp[0];
 				}
 			}
 			*isRateUp = 0;
-			getRateUp[1] = 1;
+			st->getRateUp[1] = 1;
 			// Character banners don't use Fate Points, but best to set it anyway
-			fatePoints++;
-			getrandom(&rnd, sizeof(long long), 0);
-			return FiveStarChr[rnd % FiveStarMaxIndex[stdPoolIndex]];
+			st->fatePoints++;
+			return pb->five[pickFrom(&st->rng, pb->fiveChrCnt)];
 		case WPN:
 			// Weapon banner does not use the stable function for 5-stars
-			pityS[2] = 0;
-			pityS[3] = 0;
-			if (fatePoints < doEpitomized && !getRateUp[1]) {
-				getrandom(&rnd, sizeof(long long), 0);
+			st->pityS[2] = 0;
+			st->pityS[3] = 0;
+			if (st->fatePoints < epitomized && !guaranteed(fl, st, 1)) {
+				rnd = STAT_DRAW(DRAW_RATE_UP, rndBits_r(&st->rng, 2));
 			}
 			else rnd = 0;
-			if (rnd % 4 < 3) {
+			if (rnd < 3) {
 				*isRateUp = 1;
-				getRateUp[1] = 0;
-				if (fatePoints >= doEpitomized) {
-					fatePoints = 0;
-					return epitomizedPath;
+				st->getRateUp[1] = 0;
+				if (st->fatePoints >= epitomized) {
+					st->fatePoints = 0;
+					return st->epitomizedPath;
 				}
 				else {
-					getrandom(&rnd, sizeof(long long), 0);
-					if (epitomizedPath) {
-						if (FiveStarWpnUp[bannerIndex][rnd % 2] == epitomizedPath) {
-							fatePoints = 0;
+					rnd = STAT_DRAW(DRAW_POOL, rndBits_r(&st->rng, 1));
+					if (st->epitomizedPath) {
+						if (pb->fiveUp[rnd] == st->epitomizedPath) {
+							st->fatePoints = 0;
 						}
 						else {
-							fatePoints++;
+							st->fatePoints++;
 						}
 					}
-					return FiveStarWpnUp[bannerIndex][rnd % 2];
+					return pb->fiveUp[rnd];
 				}
 			}
 			else {
 				*isRateUp = 0;
-				getRateUp[1] = 1;
-				fatePoints++;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FiveStarWpn[rnd % 10];
+				st->getRateUp[1] = 1;
+				st->fatePoints++;
+				return pb->five[pb->fiveChrCnt + pickFrom(&st->rng, pb->fiveWpnCnt)];
 			}
 		case CHRONICLED:
-			if (ChroniclePool == NULL) {
-				return -1;
-			}
-			pool = ChroniclePool->FiveStarPool;
+			pool = pb->five;
 			minIdx = 0;
-			maxIdx = ChroniclePool->FiveStarWeaponCount + ChroniclePool->FiveStarCharCount;
+			maxIdx = pb->fiveWpnCnt + pb->fiveChrCnt;
 
-			if (epitomizedPath && doEpitomized) {
+			if (st->epitomizedPath && epitomized) {
 				// If Chronicled Path is set, behave like a weapon event banner.
 				// No point to use the stable function in this case.
-				pityS[2] = 0;
-				pityS[3] = 0;
-				if (epitomizedPath >= 10000) {
-					minIdx = ChroniclePool->FiveStarCharCount;
+				st->pityS[2] = 0;
+				st->pityS[3] = 0;
+				if (st->epitomizedPath >= 10000) {
+					minIdx = pb->fiveChrCnt;
 				}
 				else {
-					maxIdx = ChroniclePool->FiveStarCharCount;
+					maxIdx = pb->fiveChrCnt;
 				}
-				if (fatePoints < doEpitomized && !getRateUp[1]) {
-					getrandom(&rnd, sizeof(long long), 0);
+				if (st->fatePoints < epitomized && !guaranteed(fl, st, 1)) {
+					rnd = STAT_DRAW(DRAW_RATE_UP, rndBits_r(&st->rng, 1));
 				}
 				else rnd = 0;
-				if (rnd % 2 == 0) {
+				if (rnd == 0) {
 					*isRateUp = 1;
-					getRateUp[1] = 0;
-					fatePoints = 0;
-					return epitomizedPath;
+					st->getRateUp[1] = 0;
+					st->fatePoints = 0;
+					return st->epitomizedPath;
 				}
 				else {
-					getrandom(&rnd, sizeof(long long), 0);
-					if (pool[(rnd % (maxIdx - minIdx)) + minIdx] == epitomizedPath) {
+					rnd = minIdx + pickFrom(&st->rng, maxIdx - minIdx);
+					if (pool[rnd] == st->epitomizedPath) {
 						*isRateUp = 1;
-						getRateUp[1] = 0;
-						fatePoints = 0;
+						st->getRateUp[1] = 0;
+						st->fatePoints = 0;
 					}
 					else {
 						*isRateUp = 0;
-						getRateUp[1] = 1;
-						fatePoints++;
+						st->getRateUp[1] = 1;
+						st->fatePoints++;
 					}
-					return pool[(rnd % (maxIdx - minIdx)) + minIdx];
+					return pool[rnd];
 				}
 			}
 			else {
 				// Else, behave like the standard banner.
 				// Signal that all pulls are rate-up in this case.
 				*isRateUp = 1;
-				getRateUp[1] = 0;
-				fatePoints = 0;
-				rndF = rndFloat();
-				if (doSmooth[1] >= 0) {
-					if (pityS[2] <= pityS[3]) {
-						if (rndF <= getWeight5S(pityS[3])) {
-							pityS[3] = 0;
-							minIdx = ChroniclePool->FiveStarCharCount;
+				st->getRateUp[1] = 0;
+				st->fatePoints = 0;
+				rndFx = STAT_DRAW(DRAW_STABLE, rndFixed_r(&st->rng));
+				if (fl->doSmooth[1] >= 0) {
+					if (st->pityS[2] <= st->pityS[3]) {
+						if (rndFx < smoothThr(thr5S, fl->doSmooth[1], st->pityS[3])) {
+							st->pityS[3] = 0;
+							minIdx = pb->fiveChrCnt;
 
 						}
 						else {
-							pityS[2] = 0;
-							maxIdx = ChroniclePool->FiveStarCharCount;
+							st->pityS[2] = 0;
+							maxIdx = pb->fiveChrCnt;
 						}
 					}
 					else {
-						if (rndF <= getWeight5S(pityS[2])) {
-							pityS[2] = 0;
-							maxIdx = ChroniclePool->FiveStarCharCount;
+						if (rndFx < smoothThr(thr5S, fl->doSmooth[1], st->pityS[2])) {
+							st->pityS[2] = 0;
+							maxIdx = pb->fiveChrCnt;
 						}
 						else {
-							pityS[3] = 0;
-							minIdx = ChroniclePool->FiveStarCharCount;
+							st->pityS[3] = 0;
+							minIdx = pb->fiveChrCnt;
 						}
 					}
 				}
 			}
-			getrandom(&rnd, sizeof(long long), 0);
-			return pool[(rnd % (maxIdx - minIdx)) + minIdx];
+			return pool[minIdx + pickFrom(&st->rng, maxIdx - minIdx)];
 		case NOVICE:
 		case STD_ONLY_CHR: // Same drops for 5-stars in this case
 			// Novice banner does not use the rate-up function
 			*isRateUp = 0;
-			getRateUp[1] = 0;
+			st->getRateUp[1] = 0;
 			// Novice banner does not use Fate Points
-			fatePoints = 0;
+			st->fatePoints = 0;
 			// Novice banner does not use the stable function
-			pityS[2] = 0;
-			pityS[3] = 0;
-			getrandom(&rnd, sizeof(long long), 0);
-			return FiveStarChr[rnd % FiveStarMaxIndex[stdPoolIndex]];
+			st->pityS[2] = 0;
+			st->pityS[3] = 0;
+			return pb->five[pickFrom(&st->rng, pb->fiveChrCnt)];
 		case STD_WPN:
 			// Standard banner does not use the rate-up function
 			*isRateUp = 0;
-			getRateUp[1] = 0;
+			st->getRateUp[1] = 0;
 			// Standard banner does not use Fate Points
-			fatePoints = 0;
+			st->fatePoints = 0;
 			// There's no point to use the stable function here, because then the banner's drop rates would be nearly identical to the vanilla standard banner
-			pityS[2] = 0;
-			pityS[3] = 0;
-			getrandom(&rnd, sizeof(long long), 0);
-			return FiveStarWpn[rnd % 10];
+			st->pityS[2] = 0;
+			st->pityS[3] = 0;
+			return pb->five[pb->fiveChrCnt + pickFrom(&st->rng, pb->fiveWpnCnt)];
 		case STD_CHR:
 		default:
 			// Standard banner does not use the rate-up function
 			*isRateUp = 0;
-			getRateUp[1] = 0;
+			st->getRateUp[1] = 0;
 			// Standard banner does not use Fate Points
-			fatePoints = 0;
-			rndF = rndFloat();
-			if (doSmooth[1] < 0) {
-				minIdx = FiveStarMaxIndex[stdPoolIndex];
-				maxIdx = minIdx + 10;
-				getrandom(&rnd, sizeof(long long), 0);
-				if ((rnd % maxIdx) < minIdx) {
-					return FiveStarChr[rnd % minIdx];
-				}
-				else {
-					minIdx = (rnd % maxIdx) - minIdx;
-					return FiveStarWpn[minIdx];
-				}
+			st->fatePoints = 0;
+			rndFx = STAT_DRAW(DRAW_STABLE, rndFixed_r(&st->rng));
+			if (fl->doSmooth[1] < 0) {
+				// Pools are stored characters first, then weapons
+				return pb->five[pickFrom(&st->rng, pb->fiveChrCnt + pb->fiveWpnCnt)];
 			}
-			if (pityS[2] <= pityS[3]) {
-				if (rndF <= getWeight5S(pityS[3])) {
-					pityS[3] = 0;
-					getrandom(&rnd, sizeof(long long), 0);
-					return FiveStarWpn[rnd % 10];
+			if (st->pityS[2] <= st->pityS[3]) {
+				if (rndFx < smoothThr(thr5S, fl->doSmooth[1], st->pityS[3])) {
+					st->pityS[3] = 0;
+					return pb->five[pb->fiveChrCnt + pickFrom(&st->rng, pb->fiveWpnCnt)];
 				}
-				pityS[2] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FiveStarChr[rnd % FiveStarMaxIndex[stdPoolIndex]];
+				st->pityS[2] = 0;
+				return pb->five[pickFrom(&st->rng, pb->fiveChrCnt)];
 			}
-			if (rndF <= getWeight5S(pityS[2])) {
-				pityS[2] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FiveStarChr[rnd % FiveStarMaxIndex[stdPoolIndex]];
+			if (rndFx < smoothThr(thr5S, fl->doSmooth[1], st->pityS[2])) {
+				st->pityS[2] = 0;
+				return pb->five[pickFrom(&st->rng, pb->fiveChrCnt)];
 			}
-			pityS[3] = 0;
-			getrandom(&rnd, sizeof(long long), 0);
-			return FiveStarWpn[rnd % 10];
+			st->pityS[3] = 0;
+			return pb->five[pb->fiveChrCnt + pickFrom(&st->rng, pb->fiveWpnCnt)];
 		}
 	}
-	else if (rndF <= _getWeight(pity[0], 4)) {
+	else if (rndFx < pityThr(pb->thrFour, fl->doPity[0], st->pity[0])) {
 		*rare = 4;
-		pity[0] = 0;
+		STAT_INC(arms[1][pb->banner]);
+		STAT_INC_IF(pityThr(pb->thrFour, fl->doPity[0], st->pity[0]) > pb->thrFour[0], softPity[0]);
+		st->pity[0] = 0;
 		switch (banner) {
 		case CHAR1:
 		case CHAR2:
-			if (!getRateUp[0]) {
-				getrandom(&rnd, sizeof(long long), 0);
+			if (!guaranteed(fl, st, 0)) {
+				rnd = STAT_DRAW(DRAW_RATE_UP, rndBits_r(&st->rng, 1));
 			}
 			else rnd = 0;
-			if (rnd % 2 == 0) {
+			if (rnd == 0) {
 				*isRateUp = 1;
-				getRateUp[0] = 0;
-				pityS[0] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarChrUp[bannerIndex][rnd % 3];
+				st->getRateUp[0] = 0;
+				st->pityS[0] = 0;
+				return pb->fourUp[pickFrom(&st->rng, 3)];
 			}
 			*isRateUp = 0;
-			getRateUp[0] = 1;
-			rndF = rndFloat();
-			if (doSmooth[0] < 0) {
-				minIdx = FourStarMaxIndex[stdPoolIndex];
-				maxIdx = minIdx + 18;
-				getrandom(&rnd, sizeof(long long), 0);
-				if ((rnd % maxIdx) < minIdx) {
-					return FourStarChr[(rnd % minIdx) + 3];
-				}
-				else {
-					minIdx = (rnd % maxIdx) - minIdx;
-					return FourStarWpn[minIdx];
-				}
+			st->getRateUp[0] = 1;
+			rndFx = STAT_DRAW(DRAW_STABLE, rndFixed_r(&st->rng));
+			if (fl->doSmooth[0] < 0) {
+				// Pools are stored characters first, then weapons
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt + pb->fourWpnCnt)];
 			}
-			if (pityS[0] <= pityS[1]) {
-				if (rndF <= getWeight4S(pityS[1])) {
-					pityS[1] = 0;
-					getrandom(&rnd, sizeof(long long), 0);
-					return FourStarWpn[rnd % 18];
+			if (st->pityS[0] <= st->pityS[1]) {
+				if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[1])) {
+					st->pityS[1] = 0;
+					return pb->four[pb->fourChrCnt + pickFrom(&st->rng, pb->fourWpnCnt)];
 				}
-				pityS[0] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarChr[(rnd % FourStarMaxIndex[stdPoolIndex]) + 3];
+				st->pityS[0] = 0;
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt)];
 			}
-			if (rndF <= getWeight4S(pityS[0])) {
-				pityS[0] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarChr[(rnd % FourStarMaxIndex[stdPoolIndex]) + 3];
+			if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[0])) {
+				st->pityS[0] = 0;
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt)];
 			}
-			pityS[1] = 0;
-			getrandom(&rnd, sizeof(long long), 0);
-			return FourStarWpn[rnd % 18];
+			st->pityS[1] = 0;
+			return pb->four[pb->fourChrCnt + pickFrom(&st->rng, pb->fourWpnCnt)];
 		case WPN:
-			if (!getRateUp[0]) {
-				getrandom(&rnd, sizeof(long long), 0);
+			if (!guaranteed(fl, st, 0)) {
+				rnd = STAT_DRAW(DRAW_RATE_UP, rndBits_r(&st->rng, 2));
 			}
 			else rnd = 0;
-			if (rnd % 4 < 3) {
+			if (rnd < 3) {
 				*isRateUp = 1;
-				getRateUp[0] = 0;
-				pityS[1] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarWpnUp[bannerIndex][rnd % 5];
+				st->getRateUp[0] = 0;
+				st->pityS[1] = 0;
+				return pb->fourUp[pickFrom(&st->rng, 5)];
 			}
 			*isRateUp = 0;
-			getRateUp[0] = 1;
-			rndF = rndFloat();
-			if (doSmooth[0] < 0) {
-				minIdx = FourStarMaxIndex[stdPoolIndex];
-				maxIdx = minIdx + 18;
-				getrandom(&rnd, sizeof(long long), 0);
-				if ((rnd % maxIdx) < minIdx) {
-					return FourStarChr[(rnd % minIdx) + 3];
-				}
-				else {
-					minIdx = (rnd % maxIdx) - minIdx;
-					return FourStarWpn[minIdx];
-				}
+			st->getRateUp[0] = 1;
+			rndFx = STAT_DRAW(DRAW_STABLE, rndFixed_r(&st->rng));
+			if (fl->doSmooth[0] < 0) {
+				// Pools are stored characters first, then weapons
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt + pb->fourWpnCnt)];
 			}
-			if (pityS[0] <= pityS[1]) {
-				if (rndF <= getWeight4SW(pityS[1])) {
-					pityS[1] = 0;
-					getrandom(&rnd, sizeof(long long), 0);
-					return FourStarWpn[rnd % 18];
+			if (st->pityS[0] <= st->pityS[1]) {
+				if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[1])) {
+					st->pityS[1] = 0;
+					return pb->four[pb->fourChrCnt + pickFrom(&st->rng, pb->fourWpnCnt)];
 				}
-				pityS[0] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarChr[(rnd % FourStarMaxIndex[stdPoolIndex]) + 3];
+				st->pityS[0] = 0;
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt)];
 			}
-			if (rndF <= getWeight4SW(pityS[0])) {
-				pityS[0] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarChr[(rnd % FourStarMaxIndex[stdPoolIndex]) + 3];
+			if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[0])) {
+				st->pityS[0] = 0;
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt)];
 			}
-			pityS[1] = 0;
-			getrandom(&rnd, sizeof(long long), 0);
-			return FourStarWpn[rnd % 18];
+			st->pityS[1] = 0;
+			return pb->four[pb->fourChrCnt + pickFrom(&st->rng, pb->fourWpnCnt)];
 		case CHRONICLED:
-			if (ChroniclePool == NULL) {
-				return -1;
-			}
 			*isRateUp = 1;
-			getRateUp[0] = 0;
-			pool = ChroniclePool->FourStarPool;
+			st->getRateUp[0] = 0;
+			pool = pb->four;
 			minIdx = 0;
-			maxIdx = ChroniclePool->FourStarWeaponCount + ChroniclePool->FourStarCharCount;
+			maxIdx = pb->fourWpnCnt + pb->fourChrCnt;
 
-			rndF = rndFloat();
-			if (doSmooth[0] >= 0) {
-				if (pityS[0] <= pityS[1]) {
-					if (rndF <= getWeight4S(pityS[1])) {
-						pityS[1] = 0;
-						minIdx = ChroniclePool->FourStarCharCount;
+			rndFx = STAT_DRAW(DRAW_STABLE, rndFixed_r(&st->rng));
+			if (fl->doSmooth[0] >= 0) {
+				if (st->pityS[0] <= st->pityS[1]) {
+					if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[1])) {
+						st->pityS[1] = 0;
+						minIdx = pb->fourChrCnt;
 
 					}
 					else {
-						pityS[0] = 0;
-						maxIdx = ChroniclePool->FourStarCharCount;
+						st->pityS[0] = 0;
+						maxIdx = pb->fourChrCnt;
 					}
 				}
 				else {
-					if (rndF <= getWeight4S(pityS[0])) {
-						pityS[0] = 0;
-						maxIdx = ChroniclePool->FourStarCharCount;
+					if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[0])) {
+						st->pityS[0] = 0;
+						maxIdx = pb->fourChrCnt;
 					}
 					else {
-						pityS[1] = 0;
-						minIdx = ChroniclePool->FourStarCharCount;
+						st->pityS[1] = 0;
+						minIdx = pb->fourChrCnt;
 					}
 				}
 			}
-			getrandom(&rnd, sizeof(long long), 0);
-			return pool[(rnd % (maxIdx - minIdx)) + minIdx];
+			return pool[minIdx + pickFrom(&st->rng, maxIdx - minIdx)];
 		case NOVICE:
 			*isRateUp = 0;
 			// Novice banner does not use the rate-up function
-			getRateUp[0] = 0;
+			st->getRateUp[0] = 0;
 			// Novice banner does not use the stable function
-			pityS[0] = 0;
-			pityS[1] = 0;
-			rndF = rndFloat();
-			getrandom(&rnd, sizeof(long long), 0);
-			return FourStarChr[(rnd % FourStarMaxIndex[stdPoolIndex]) + 3];
+			st->pityS[0] = 0;
+			st->pityS[1] = 0;
+			rndFx = STAT_DRAW(DRAW_STABLE, rndFixed_r(&st->rng));
+			return pb->four[pickFrom(&st->rng, pb->fourChrCnt)];
 		case STD_CHR:
 		case STD_ONLY_CHR:
 		default:
 			// Standard banner does not use the rate-up function
 			*isRateUp = 0;
-			getRateUp[0] = 0;
-			rndF = rndFloat();
-			if (doSmooth[0] < 0) {
-				minIdx = FourStarMaxIndex[stdPoolIndex] + 3;
-				maxIdx = minIdx + 18;
-				getrandom(&rnd, sizeof(long long), 0);
-				if ((rnd % maxIdx) < minIdx) {
-					return FourStarChr[rnd % minIdx];
-				}
-				else {
-					minIdx = (rnd % maxIdx) - minIdx;
-					return FourStarWpn[minIdx];
-				}
+			st->getRateUp[0] = 0;
+			rndFx = STAT_DRAW(DRAW_STABLE, rndFixed_r(&st->rng));
+			if (fl->doSmooth[0] < 0) {
+				// Pools are stored characters first, then weapons
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt + pb->fourWpnCnt)];
 			}
-			if (pityS[0] <= pityS[1]) {
-				if (rndF <= getWeight4S(pityS[1])) {
-					pityS[1] = 0;
-					getrandom(&rnd, sizeof(long long), 0);
-					return FourStarWpn[rnd % 18];
+			if (st->pityS[0] <= st->pityS[1]) {
+				if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[1])) {
+					st->pityS[1] = 0;
+					return pb->four[pb->fourChrCnt + pickFrom(&st->rng, pb->fourWpnCnt)];
 				}
-				pityS[0] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarChr[rnd % (FourStarMaxIndex[stdPoolIndex] + 3)];
+				st->pityS[0] = 0;
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt)];
 			}
-			if (rndF <= getWeight4S(pityS[0])) {
-				pityS[0] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarChr[rnd % (FourStarMaxIndex[stdPoolIndex] + 3)];
+			if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[0])) {
+				st->pityS[0] = 0;
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt)];
 			}
-			pityS[1] = 0;
-			getrandom(&rnd, sizeof(long long), 0);
-			return FourStarWpn[rnd % 18];
+			st->pityS[1] = 0;
+			return pb->four[pb->fourChrCnt + pickFrom(&st->rng, pb->fourWpnCnt)];
 		case STD_WPN:
 			// Standard banner does not use the rate-up function
 			*isRateUp = 0;
-			getRateUp[0] = 0;
-			rndF = rndFloat();
-			if (doSmooth[0] < 0) {
-				minIdx = FourStarMaxIndex[stdPoolIndex] + 3;
-				maxIdx = minIdx + 18;
-				getrandom(&rnd, sizeof(long long), 0);
-				if ((rnd % maxIdx) < minIdx) {
-					return FourStarChr[rnd % minIdx];
-				}
-				else {
-					minIdx = (rnd % maxIdx) - minIdx;
-					return FourStarWpn[minIdx];
-				}
+			st->getRateUp[0] = 0;
+			rndFx = STAT_DRAW(DRAW_STABLE, rndFixed_r(&st->rng));
+			if (fl->doSmooth[0] < 0) {
+				// Pools are stored characters first, then weapons
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt + pb->fourWpnCnt)];
 			}
-			if (pityS[0] <= pityS[1]) {
-				if (rndF <= getWeight4SW(pityS[1])) {
-					pityS[1] = 0;
-					getrandom(&rnd, sizeof(long long), 0);
-					return FourStarWpn[rnd % 18];
+			if (st->pityS[0] <= st->pityS[1]) {
+				if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[1])) {
+					st->pityS[1] = 0;
+					return pb->four[pb->fourChrCnt + pickFrom(&st->rng, pb->fourWpnCnt)];
 				}
-				pityS[0] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarChr[rnd % (FourStarMaxIndex[stdPoolIndex] + 3)];
+				st->pityS[0] = 0;
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt)];
 			}
-			if (rndF <= getWeight4SW(pityS[0])) {
-				pityS[0] = 0;
-				getrandom(&rnd, sizeof(long long), 0);
-				return FourStarChr[rnd % (FourStarMaxIndex[stdPoolIndex] + 3)];
+			if (rndFx < smoothThr(pb->thrFourS, fl->doSmooth[0], st->pityS[0])) {
+				st->pityS[0] = 0;
+				return pb->four[pickFrom(&st->rng, pb->fourChrCnt)];
 			}
-			pityS[1] = 0;
-			getrandom(&rnd, sizeof(long long), 0);
-			return FourStarWpn[rnd % 18];
+			st->pityS[1] = 0;
+			return pb->four[pb->fourChrCnt + pickFrom(&st->rng, pb->fourWpnCnt)];
 		}
 	}
 	else {
 		*isRateUp = 0;
 		*rare = 3;
-		getrandom(&rnd, sizeof(long long), 0);
-		return ThreeStar[rnd % 13];
+		STAT_INC(arms[2][pb->banner]);
+		return pb->three[pickFrom(&st->rng, pb->threeCnt)];
+	}
+}
+
+#define PULL_KERNEL(name, type, flags) \
+static unsigned int name(GachaState_t* st, const GachaConfig_t* cfg, const PreparedBanner_t* pb, unsigned long long rndFx, unsigned int* rare, unsigned int* isRateUp) { \
+	return finishPullT(st, cfg, pb, rndFx, rare, isRateUp, type, flags); \
+}
+#define PULL_KERNELS(tag, flags) \
+PULL_KERNEL(finishStd##tag, STD_CHR, flags) \
+PULL_KERNEL(finishStdWpn##tag, STD_WPN, flags) \
+PULL_KERNEL(finishChar##tag, CHAR1, flags) \
+PULL_KERNEL(finishWpn##tag, WPN, flags) \
+PULL_KERNEL(finishNovice##tag, NOVICE, flags) \
+PULL_KERNEL(finishChronicled##tag, CHRONICLED, flags) \
+PULL_KERNEL(finishStdOnlyChr##tag, STD_ONLY_CHR, flags)
+#define KERNEL_ROW(tag) { \
+	[STD_CHR] = finishStd##tag, \
+	[STD_WPN] = finishStdWpn##tag, \
+	[CHAR1] = finishChar##tag, \
+	[CHAR2] = finishChar##tag, \
+	[WPN] = finishWpn##tag, \
+	[NOVICE] = finishNovice##tag, \
+	[CHRONICLED] = finishChronicled##tag, \
+	[STD_ONLY_CHR] = finishStdOnlyChr##tag, \
+}
+PULL_KERNELS(, FLAGS_GENERIC)
+PULL_KERNELS(Default, FLAGS_DEFAULT)
+PULL_KERNELS(NoPity, FLAGS_NO_PITY)
+PULL_KERNELS(NoSmooth, FLAGS_NO_SMOOTH)
+PULL_KERNELS(RateUp, FLAGS_RATE_UP)
+PULL_KERNELS(OldSmooth, FLAGS_OLD_SMOOTH)
+
+static PullKernel_t* const pullKernels[FLAGS_CNT][WISH_CNT] = {
+	[FLAGS_GENERIC] = KERNEL_ROW(),
+	[FLAGS_DEFAULT] = KERNEL_ROW(Default),
+	[FLAGS_NO_PITY] = KERNEL_ROW(NoPity),
+	[FLAGS_NO_SMOOTH] = KERNEL_ROW(NoSmooth),
+	[FLAGS_RATE_UP] = KERNEL_ROW(RateUp),
+	[FLAGS_OLD_SMOOTH] = KERNEL_ROW(OldSmooth),
+};
+
+// The chosen kernel ignores the flags it was specialized for, so this has to be called again whenever they change.
+void selectKernel(PreparedBanner_t* pb, const GachaConfig_t* cfg) {
+	unsigned int i;
+	const GachaConfig_t* f;
+	pb->finish = pullKernels[FLAGS_GENERIC][pb->banner];
+	for (i = FLAGS_GENERIC + 1; i < FLAGS_CNT; i++) {
+		f = &flagSets[i];
+		if (cfg->doSmooth[0] == f->doSmooth[0] && cfg->doSmooth[1] == f->doSmooth[1] && cfg->doPity[0] == f->doPity[0] && cfg->doPity[1] == f->doPity[1] && cfg->do5050 == f->do5050) {
+			pb->finish = pullKernels[i][pb->banner];
+			return;
+		}
 	}
 }
+
+// Banner last prepared by getPreparedBanner in this thread, and what it was prepared for
+static _Thread_local struct {
+	int valid;
+	unsigned int banner;
+	unsigned int stdPoolIndex;
+	unsigned int bannerIndex;
+	int doSmooth[2];
+	int doPity[2];
+	int do5050;
+	PreparedBanner_t pb;
+} cache;
+
+// Gives the banner prepared with its kernel selected, only preparing it again when the banner or the flags the kernel depends on change
+#ifndef DEBUG
+static const PreparedBanner_t* getPreparedBanner(const GachaConfig_t* cfg, unsigned int banner, unsigned int stdPoolIndex, unsigned int bannerIndex) {
+#else
+static const PreparedBanner_t* getPreparedBanner(const GachaConfig_t* cfg, unsigned int banner, int stdPoolIndex, int bannerIndex) {
+#endif
+	if (cache.valid && cache.banner == banner && cache.stdPoolIndex == (unsigned int) stdPoolIndex && cache.bannerIndex == (unsigned int) bannerIndex && cache.doSmooth[0] == cfg->doSmooth[0] && cache.doSmooth[1] == cfg->doSmooth[1] && cache.doPity[0] == cfg->doPity[0] && cache.doPity[1] == cfg->doPity[1] && cache.do5050 == cfg->do5050) {
+		return &cache.pb;
+	}
+	cache.valid = 0;
+	if (prepareBanner(&cache.pb, banner, stdPoolIndex, bannerIndex) < 0) return NULL;
+	selectKernel(&cache.pb, cfg);
+	cache.banner = banner;
+	cache.stdPoolIndex = stdPoolIndex;
+	cache.bannerIndex = bannerIndex;
+	memcpy(cache.doSmooth, cfg->doSmooth, sizeof(cache.doSmooth));
+	memcpy(cache.doPity, cfg->doPity, sizeof(cache.doPity));
+	cache.do5050 = cfg->do5050;
+	cache.valid = 1;
+	return &cache.pb;
+}
+
+#ifndef DEBUG
+unsigned int doAPull_r(GachaState_t* st, const GachaConfig_t* cfg, unsigned int banner, unsigned int stdPoolIndex, unsigned int bannerIndex, unsigned int* rare, unsigned int* isRateUp) {
+#else
+unsigned int doAPull_r(GachaState_t* st, const GachaConfig_t* cfg, unsigned int banner, int stdPoolIndex, int bannerIndex, unsigned int* rare, unsigned int* isRateUp) {
+#endif
+	const PreparedBanner_t* pb;
+	if (st == NULL) return -1;
+	if (cfg == NULL) return -1;
+	if (rare == NULL) return -1;
+	if (isRateUp == NULL) return -1;
+	pb = getPreparedBanner(cfg, banner, stdPoolIndex, bannerIndex);
+	if (pb == NULL) return -1;
+	return doAPull_p(st, cfg, pb, rare, isRateUp);
+}
+
+unsigned int doAWish(GachaState_t* st, const GachaConfig_t* cfg, const Session_t* ses, unsigned int i, unsigned int* rare, unsigned int* isRateUp) {
+	if (ses->pb.banner == NOVICE && i == (7 - ses->noviceCnt)) { // 8th wish is always Noelle on novice banner
+		*rare = 4;
+		*isRateUp = 0;
+		st->getRateUp[0] = 0;
+		st->pity[0] = 0;
+		st->pity[1]++;
+		st->pityS[0] = 0;
+		st->pityS[1] = 0;
+		return 1034;
+	}
+	if (ses->forceSmooth & 1) {
+		st->pityS[0] = ~1;
+		st->pityS[2] = ~1;
+		st->pityS[1] = -1;
+		st->pityS[3] = -1;
+	}
+	if (ses->forceSmooth & 2) {
+		st->pityS[1] = ~1;
+		st->pityS[3] = ~1;
+		st->pityS[0] = -1;
+		st->pityS[2] = -1;
+	}
+	// TODO Implement logic for character vs. item pool instead of checking the ID to determine that
+	return doAPull_p(st, cfg, &ses->pb, rare, isRateUp);
+}
+
+// The random numbers for all 10 wishes are drawn up front in one block; each wish takes 2 or 3 words most of the time.
+void doTenPull(GachaState_t* st, const GachaConfig_t* cfg, const Session_t* ses, unsigned int wishNo, PullResult_t* res) {
+	unsigned int i, rare, isRateUp;
+	rngReserve(&st->rng);
+	for (i = 0; i < 10; i++) {
+		res[i].item = doAWish(st, cfg, ses, wishNo + i, &rare, &isRateUp);
+		res[i].rare = rare;
+		res[i].isRateUp = isRateUp;
+		res[i].pity[0] = st->pity[0];
+		res[i].pity[1] = st->pity[1];
+		res[i].fatePoints = st->fatePoints;
+	}
+}
+
+// Same as a run of doTenPull, but only keeps what fits in a packed record
+void doWishesPacked(GachaState_t* st, const GachaConfig_t* cfg, const Session_t* ses, unsigned int wishNo, unsigned int n, unsigned int* res) {
+	unsigned int i, item, rare, isRateUp;
+	for (i = 0; i < n; i++) {
+		if (i % 10 == 0) rngReserve(&st->rng);
+		item = doAWish(st, cfg, ses, wishNo + i, &rare, &isRateUp);
+		res[i] = PULL_PACK(item, rare, isRateUp);
+	}
+}
+
+// Non-reentrant variant operating on the global state and configuration
+#ifndef DEBUG
+unsigned int doAPull(unsigned int banner, unsigned int stdPoolIndex, unsigned int bannerIndex, unsigned int* rare, unsigned int* isRateUp) {
+#else
+unsigned int doAPull(unsigned int banner, int stdPoolIndex, int bannerIndex, unsigned int* rare, unsigned int* isRateUp) {
+#endif
+	GachaConfig_t cfg;
+	memcpy(cfg.doSmooth, doSmooth, sizeof(doSmooth));
+	memcpy(cfg.doPity, doPity, sizeof(doPity));
+	cfg.do5050 = do5050;
+	cfg.doEpitomized = doEpitomized;
+	cfg.doRadiance = doRadiance;
+	return doAPull_r(&gachaState, &cfg, banner, stdPoolIndex, bannerIndex, rare, isRateUp);
+}
+
+unsigned long long rndWord() {
+	return rndWord_r(&gachaState.rng);
+}
+
+long double rndFloat() {
+	return rndFloat_r(&gachaState.rng);
+}
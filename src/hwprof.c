@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "hwprof.h"
+#include "util.h"
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#define CACHE_MISS(c) ((c) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+
+enum {
+	HW_CYCLES = 0,
+	HW_INSTRUCTIONS,
+	HW_BRANCH_MISSES,
+	HW_L1D_MISSES,
+	HW_LLC_MISSES,
+	HW_CNT
+};
+
+static const struct {
+	const char* name;
+	unsigned int type;
+	unsigned long long config;
+} events[HW_CNT] = {
+	[HW_CYCLES] = {_N("cycles"), PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+	[HW_INSTRUCTIONS] = {_N("instructions"), PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+	[HW_BRANCH_MISSES] = {_N("branch misses"), PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+	[HW_L1D_MISSES] = {_N("L1d read misses"), PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_L1D)},
+	[HW_LLC_MISSES] = {_N("LLC read misses"), PERF_TYPE_HW_CACHE, CACHE_MISS(PERF_COUNT_HW_CACHE_LL)},
+};
+
+static int fds[HW_CNT] = {-1, -1, -1, -1, -1};
+static int errs[HW_CNT];
+
+int hwprofStart(void) {
+	struct perf_event_attr attr;
+	unsigned int i;
+	int cnt = 0;
+	for (i = 0; i < HW_CNT; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = events[i].type;
+		attr.config = events[i].config;
+		attr.disabled = 1;
+		attr.inherit = 1;
+		// Only what the simulation itself does, which also keeps it allowed at the default perf_event_paranoid level
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		// The kernel may have to share the PMU between counters; these let hwprofStop scale the counts back up
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (fds[i] < 0) {
+			errs[i] = errno;
+			continue;
+		}
+		cnt++;
+	}
+	if (cnt == 0) {
+		fprintf(stderr, _("Hardware counters are not available (%s), --profile-hw will be ignored.\n"), strerror(errs[HW_CYCLES]));
+		return 0;
+	}
+	for (i = 0; i < HW_CNT; i++) {
+		if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+	return cnt;
+}
+
+void hwprofStop(unsigned long long pulls) {
+	unsigned long long v[3];
+	double val[HW_CNT];
+	int ok[HW_CNT] = {0};
+	unsigned int i;
+	int any = 0;
+	for (i = 0; i < HW_CNT; i++) {
+		if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+	for (i = 0; i < HW_CNT; i++) {
+		if (fds[i] < 0) continue;
+		if (read(fds[i], v, sizeof(v)) == sizeof(v) && v[2] != 0) {
+			val[i] = v[2] < v[1] ? (double) v[0] * v[1] / v[2] : v[0];
+			ok[i] = 1;
+			any = 1;
+		}
+		else if (errs[i] == 0) errs[i] = ENODATA;
+		close(fds[i]);
+		fds[i] = -1;
+	}
+	if (!any || pulls == 0) return;
+	fflush(stdout);
+	fprintf(stderr, _("\nHardware counters per pull (%llu pulls):\n"), pulls);
+	for (i = 0; i < HW_CNT; i++) {
+		if (ok[i]) fprintf(stderr, "\t%-24s %12.3f\n", gettext(events[i].name), val[i] / pulls);
+		else fprintf(stderr, _("\t%-24s not available (%s)\n"), gettext(events[i].name), strerror(errs[i]));
+	}
+	if (ok[HW_CYCLES] && ok[HW_INSTRUCTIONS] && val[HW_CYCLES] > 0) {
+		fprintf(stderr, "\t%-24s %12.3f\n", _("instructions per cycle"), val[HW_INSTRUCTIONS] / val[HW_CYCLES]);
+	}
+}
+#else
+int hwprofStart(void) {
+	fprintf(stderr, _("Hardware counters are only supported on Linux, --profile-hw will be ignored.\n"));
+	return 0;
+}
+
+void hwprofStop(unsigned long long pulls) {
+	(void) pulls;
+}
+#endif
@@ -6,16 +6,26 @@
 #include "config.h"
 #include <stddef.h>
 #include "item.h"
+#include "stats.h"
 
-const char* getItem(unsigned int id) {
+static const char* itemName(unsigned int id, int translate) {
 	const char* ret;
+	STAT_INC(getItem);
 	// TODO There's gotta be a better way to do this, right?
-	ret = getCharacter(id);
+	ret = translate ? getCharacter(id) : getCharacterUntranslated(id);
 	if (ret != NULL) return ret;
-	ret = getWeapon(id);
+	ret = translate ? getWeapon(id) : getWeaponUntranslated(id);
 	if (ret != NULL) return ret;
-	ret = getArtifact(id);
+	ret = translate ? getArtifact(id) : getArtifactUntranslated(id);
 	if (ret != NULL) return ret;
 	// TODO Other items
 	return NULL;
 }
+
+const char* getItem(unsigned int id) {
+	return itemName(id, 1);
+}
+
+const char* getItemUntranslated(unsigned int id) {
+	return itemName(id, 0);
+}
@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "gacha.h"
+#include "jobs.h"
+#include "output.h"
+#include "stats.h"
+
+static void runJob(Job_t* j) {
+	unsigned int i, rare, isRateUp;
+	j->firstFive = 0;
+	j->fives = 0;
+	j->rateUpFives = 0;
+	j->fours = 0;
+	for (i = 0; i < j->pulls; i++) {
+		doAWish(&j->st, &j->cfg, &j->ses, i, &rare, &isRateUp);
+		if (rare == 5) {
+			if (j->fives++ == 0) j->firstFive = i + 1;
+			if (isRateUp) j->rateUpFives++;
+		}
+		else if (rare == 4) j->fours++;
+	}
+}
+
+static void* jobWorker(void* arg) {
+	JobPool_t* pool = arg;
+	unsigned int i;
+	pthread_mutex_lock(&pool->lock);
+	while (1) {
+		while (!pool->stop && pool->next >= pool->cnt) {
+			pthread_cond_wait(&pool->work, &pool->lock);
+		}
+		if (pool->stop) break;
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+		runJob(&pool->jobs[i]);
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->left == 0) pthread_cond_signal(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	statsFlush();
+	return NULL;
+}
+
+int jobPoolStart(JobPool_t* pool, unsigned int threads) {
+	unsigned int i;
+	if (threads == 0) return -1;
+	pool->jobs = NULL;
+	pool->cnt = 0;
+	pool->next = 0;
+	pool->left = 0;
+	pool->stop = 0;
+	pool->thread = malloc(threads * sizeof(pthread_t));
+	if (pool->thread == NULL) return -1;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	for (i = 0; i < threads; i++) {
+		if (pthread_create(&pool->thread[i], NULL, jobWorker, pool) != 0) break;
+	}
+	pool->threads = i;
+	if (i == 0) {
+		jobPoolStop(pool);
+		return -1;
+	}
+	return 0;
+}
+
+void jobPoolRun(JobPool_t* pool, Job_t* jobs, unsigned int cnt) {
+	if (cnt == 0) return;
+	pthread_mutex_lock(&pool->lock);
+	pool->jobs = jobs;
+	pool->cnt = cnt;
+	pool->next = 0;
+	pool->left = cnt;
+	pthread_cond_broadcast(&pool->work);
+	while (pool->left) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pool->cnt = 0;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void jobPoolStop(JobPool_t* pool) {
+	unsigned int i;
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 0; i < pool->threads; i++) {
+		pthread_join(pool->thread[i], NULL);
+	}
+	pthread_cond_destroy(&pool->done);
+	pthread_cond_destroy(&pool->work);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->thread);
+	pool->thread = NULL;
+	pool->threads = 0;
+}
+
+void jobBegin(FILE* f, unsigned int format) {
+	if (format != FMT_JSONL) {
+		fputs("line,banner,pulls,first_five,five_stars,rate_up_five_stars,four_stars,pity4,pity5,guaranteed4,guaranteed5,fate_points\n", f);
+	}
+}
+
+void jobRecord(FILE* f, unsigned int format, const Job_t* j) {
+	if (format == FMT_JSONL) {
+		fprintf(f, "{\"line\":%u,\"banner\":\"%s\",\"pulls\":%u,\"firstFive\":%u,\"fiveStars\":%u,\"rateUpFiveStars\":%u,\"fourStars\":%u,\"pity4\":%u,\"pity5\":%u,\"guaranteed4\":%u,\"guaranteed5\":%u,\"fatePoints\":%u}\n",
+			j->line, banners[j->ses.pb.banner][0], j->pulls, j->firstFive, j->fives, j->rateUpFives, j->fours,
+			j->st.pity[0], j->st.pity[1], j->st.getRateUp[0], j->st.getRateUp[1], j->st.fatePoints);
+	}
+	else {
+		fprintf(f, "%u,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+			j->line, banners[j->ses.pb.banner][0], j->pulls, j->firstFive, j->fives, j->rateUpFives, j->fours,
+			j->st.pity[0], j->st.pity[1], j->st.getRateUp[0], j->st.getRateUp[1], j->st.fatePoints);
+	}
+}
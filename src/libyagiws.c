@@ -0,0 +1,212 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include "yagiws.h"
+#include "gacha.h"
+#include "item.h"
+#include "util.h"
+
+// What a YgAccount_t really holds
+typedef struct {
+	GachaState_t st;
+	GachaConfig_t cfg;
+	Session_t ses;
+	unsigned int wishNo;
+} Account_t;
+
+_Static_assert(sizeof(Account_t) <= YG_ACCOUNT_SIZE, "YG_ACCOUNT_SIZE is too small");
+_Static_assert(_Alignof(Account_t) <= _Alignof(YgAccount_t), "YgAccount_t isn't aligned enough");
+_Static_assert((int) YG_WISH_CNT == (int) WISH_CNT && (int) YG_CHRONICLED == (int) CHRONICLED && (int) YG_STD_ONLY_CHR == (int) STD_ONLY_CHR, "Banner types don't match");
+_Static_assert((int) YG_RNG_CNT == (int) RNG_CNT && (int) YG_RNG_PHILOX == (int) RNG_PHILOX, "RNG engines don't match");
+_Static_assert(YG_RARE(PULL_PACK(0, 7, 0)) == 7 && YG_RATEUP(PULL_PACK(0, 0, 3)) == 3 && YG_ITEM(PULL_PACK(0xffff, 0, 0)) == 0xffff, "YgPacked_t doesn't match PULL_PACK");
+_Static_assert(sizeof(YgPull_t) == sizeof(PullResult_t) && offsetof(YgPull_t, fatePoints) == offsetof(PullResult_t, fatePoints), "YgPull_t doesn't match PullResult_t");
+
+const char* ygVersion(void) {
+	return PACKAGE_VERSION;
+}
+
+void ygDefaults(YgOptions_t* o) {
+	GachaConfig_t cfg;
+	initGachaConfig(&cfg);
+	memset(o, 0, sizeof(*o));
+	o->banner = YG_CHAR1;
+	o->version = 0x532;
+	o->rng = YG_RNG_XOSHIRO;
+	memcpy(o->doSmooth, cfg.doSmooth, sizeof(o->doSmooth));
+	memcpy(o->doPity, cfg.doPity, sizeof(o->doPity));
+	o->do5050 = cfg.do5050;
+	o->doEpitomized = cfg.doEpitomized;
+	o->doRadiance = cfg.doRadiance;
+}
+
+// Does the same checks and resolution as the main function of yagiws, minus the messages
+int ygOpen(YgAccount_t* acct, const YgOptions_t* o) {
+	Account_t* a = (Account_t*) acct;
+	const ChroniclePool_t* pool = NULL;
+	unsigned int i, banner = o->banner;
+	int idx, poolVer;
+	if (banner >= WISH_CNT) return YG_EBANNER;
+	if (o->rng >= RNG_CNT) return YG_ERNG;
+#ifndef DEBUG
+	if ((o->version & 0xf) > ((o->version >> 4) == 0x13 ? 4 : 2) || (o->version & 0xf) < 1) return YG_EVERSION;
+	if (o->pity[0] > 11 || o->pity[1] > 90 || o->fatePoints > 2) return YG_EPITY;
+	if ((banner == WPN || banner == STD_WPN) && (o->pity[0] >= 10 || o->pity[1] >= 80)) return YG_EPITY;
+#endif
+	memset(a, 0, sizeof(*a));
+	initGachaState(&a->st);
+	for (i = 0; i < 2; i++) {
+		a->st.pity[i] = o->pity[i];
+		a->st.getRateUp[i] = o->guaranteed[i] ? 1 : 0;
+		a->cfg.doSmooth[i] = o->doSmooth[i];
+		a->cfg.doPity[i] = o->doPity[i];
+	}
+	for (i = 0; i < 4; i++) {
+		a->st.pityS[i] = o->pityS[i];
+	}
+	a->st.fatePoints = o->fatePoints;
+	a->cfg.do5050 = o->do5050;
+	a->cfg.doEpitomized = o->doEpitomized;
+	a->cfg.doRadiance = o->doRadiance;
+	idx = getBannerIndex(banner, o->version);
+#ifndef DEBUG
+	// Versions before 1.0 give negative indexes, which must not reach the banner tables
+	if ((o->version >> 8) < 1 || idx < 0 || idx >= IDX_MAX * 2) return YG_EVERSION;
+#endif
+	if (banner == CHRONICLED) {
+		pool = getChroniclePool(idx);
+		if (pool == NULL) return YG_EBANNER;
+	}
+	resolveGachaConfig(&a->cfg, banner, o->version);
+	if (o->epitomizedPath) {
+#ifndef DEBUG
+		if ((banner == WPN && o->epitomizedPath > 2) || (banner == CHRONICLED && o->epitomizedPath > pool->FiveStarCharCount + pool->FiveStarWeaponCount)) return YG_EPATH;
+#endif
+		if (banner == WPN) {
+			a->st.epitomizedPath = FiveStarWpnUp[idx][o->epitomizedPath - 1];
+		}
+		else if (banner == CHRONICLED) {
+			a->st.epitomizedPath = pool->FiveStarPool[o->epitomizedPath - 1];
+		}
+	}
+	if (o->poolVersion && (banner == STD_CHR || banner == STD_WPN || a->cfg.do5050 >= 0)) {
+		poolVer = o->poolVersion;
+	}
+	else poolVer = o->version >> 4;
+#ifndef DEBUG
+	if (banner == CHAR2 && FiveStarChrUp[idx][1] == 0xffff) return YG_EBANNER;
+#endif
+	if (o->seeded) {
+		rngSeed(&a->st.rng, o->rng, o->seed);
+	}
+	else if (rngInit(&a->st.rng, o->rng) < 0) return YG_ERNG;
+	if (o->oldSmooth) {
+		for (i = 0; i < 2; i++) {
+			if (a->cfg.doSmooth[i] == 0) {
+				a->cfg.doSmooth[i] = -1;
+			}
+		}
+	}
+	if (prepareBanner(&a->ses.pb, banner, getPoolIndex(banner, poolVer), idx) < 0) return YG_EBANNER;
+	selectKernel(&a->ses.pb, &a->cfg);
+	a->ses.noviceCnt = o->noviceCnt > 8 ? 8 : o->noviceCnt;
+	a->ses.forceSmooth = (o->forceSmooth & 3) == 3 ? 0 : o->forceSmooth;
+	return 0;
+}
+
+void ygWish(YgAccount_t* acct, YgPull_t* res, unsigned int n) {
+	Account_t* a = (Account_t*) acct;
+	unsigned int rare, isRateUp;
+	for (; n >= 10; n -= 10, res += 10, a->wishNo += 10) {
+		doTenPull(&a->st, &a->cfg, &a->ses, a->wishNo, (PullResult_t*) res);
+	}
+	for (; n; n--, res++, a->wishNo++) {
+		res->item = doAWish(&a->st, &a->cfg, &a->ses, a->wishNo, &rare, &isRateUp);
+		res->rare = rare;
+		res->isRateUp = isRateUp;
+		res->pity[0] = a->st.pity[0];
+		res->pity[1] = a->st.pity[1];
+		res->fatePoints = a->st.fatePoints;
+	}
+}
+
+void ygWishPacked(YgAccount_t* acct, YgPacked_t* res, unsigned int n, YgState_t* st) {
+	Account_t* a = (Account_t*) acct;
+	doWishesPacked(&a->st, &a->cfg, &a->ses, a->wishNo, n, res);
+	a->wishNo += n;
+	if (st) ygGetState(acct, st);
+}
+
+void ygGetState(const YgAccount_t* acct, YgState_t* st) {
+	const Account_t* a = (const Account_t*) acct;
+	memcpy(st->pity, a->st.pity, sizeof(st->pity));
+	memcpy(st->pityS, a->st.pityS, sizeof(st->pityS));
+	memcpy(st->guaranteed, a->st.getRateUp, sizeof(st->guaranteed));
+	st->fatePoints = a->st.fatePoints;
+	st->epitomizedPath = a->st.epitomizedPath;
+	st->wishNo = a->wishNo;
+}
+
+unsigned int ygPool(const YgAccount_t* acct, unsigned int rare, const unsigned short** items, unsigned int* chrCnt, unsigned int* wpnCnt) {
+	const PreparedBanner_t* pb = &((const Account_t*) acct)->ses.pb;
+	switch (rare) {
+	case 5:
+		*items = pb->five;
+		*chrCnt = pb->fiveChrCnt;
+		*wpnCnt = pb->fiveWpnCnt;
+		break;
+	case 4:
+		*items = pb->four;
+		*chrCnt = pb->fourChrCnt;
+		*wpnCnt = pb->fourWpnCnt;
+		break;
+	case 3:
+		*items = pb->three;
+		*chrCnt = 0;
+		*wpnCnt = pb->threeCnt;
+		break;
+	default:
+		*items = NULL;
+		*chrCnt = 0;
+		*wpnCnt = 0;
+		break;
+	}
+	return *chrCnt + *wpnCnt;
+}
+
+unsigned int ygRateUp(const YgAccount_t* acct, unsigned int rare, const unsigned short** items) {
+	const PreparedBanner_t* pb = &((const Account_t*) acct)->ses.pb;
+	switch (rare) {
+	case 5:
+		*items = pb->fiveUp;
+		return pb->fiveUpCnt;
+	case 4:
+		*items = pb->fourUp;
+		return pb->fourUpCnt;
+	default:
+		*items = NULL;
+		return 0;
+	}
+}
+
+int ygBannerType(const char* name) {
+	unsigned int i;
+	for (i = 0; i < WISH_CNT; i++) {
+		if (strcasecmp(name, banners[i][0]) == 0) return i;
+	}
+	return YG_EBANNER;
+}
+
+const char* ygBannerName(unsigned int banner) {
+	if (banner >= WISH_CNT) return NULL;
+	return banners[banner][1];
+}
+
+const char* ygItemName(unsigned int id) {
+	return getItemUntranslated(id);
+}
@@ -0,0 +1,173 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include "gacha.h"
+#include "markov.h"
+
+// Only 5★ pity, the 5★ guarantee and Fate Points affect when a 5★ drops and what it is, so those (plus the amount of targets obtained so far) make up the state.
+// 5★ pity is stored in an unsigned char, so it's modeled with the same wraparound.
+#define PITY_CNT 256
+
+typedef struct {
+	double p;
+	unsigned int target;
+	unsigned int getRateUp;
+	unsigned int fatePoints;
+} Outcome_t;
+
+typedef struct {
+	unsigned int banner;
+	unsigned int epitomized;
+	unsigned int radiance;
+	unsigned short path;
+	// Chance that a random pick from the relevant pool is the charted item
+	double pathPick;
+	// Chance that a 50/50 between the two rate-up weapons lands on the charted item
+	double pathUp;
+} Chain_t;
+
+static inline unsigned int capFate(const Chain_t* ch, unsigned int f) {
+	return f > ch->epitomized ? ch->epitomized : f;
+}
+
+// Mirrors the 5★ branch of doAPull_r. Returns the amount of outcomes written.
+static unsigned int resolveFive(const Chain_t* ch, unsigned int g, unsigned int f, Outcome_t* out) {
+	double up;
+	unsigned int n = 0;
+	switch (ch->banner) {
+	case CHAR1:
+	case CHAR2:
+		up = g ? 1.0 : 0.5 + (ch->radiance ? 0.05 : 0.0);
+		out[n++] = (Outcome_t) {up, 1, 0, 0};
+		if (up < 1.0) out[n++] = (Outcome_t) {1.0 - up, 0, 1, capFate(ch, f + 1)};
+		return n;
+	case WPN:
+		up = (f < ch->epitomized && !g) ? 0.75 : 1.0;
+		if (f >= ch->epitomized) {
+			out[n++] = (Outcome_t) {up, 1, 0, 0};
+		}
+		else if (ch->path) {
+			if (ch->pathUp > 0.0) out[n++] = (Outcome_t) {up * ch->pathUp, 1, 0, 0};
+			if (ch->pathUp < 1.0) out[n++] = (Outcome_t) {up * (1.0 - ch->pathUp), 0, 0, capFate(ch, f + 1)};
+		}
+		else {
+			out[n++] = (Outcome_t) {up, 1, 0, f};
+		}
+		if (up < 1.0) out[n++] = (Outcome_t) {1.0 - up, 0, 1, capFate(ch, f + 1)};
+		return n;
+	case CHRONICLED:
+		if (ch->path && ch->epitomized) {
+			if (f < ch->epitomized && !g) {
+				out[n++] = (Outcome_t) {0.5 + 0.5 * ch->pathPick, 1, 0, 0};
+				if (ch->pathPick < 1.0) out[n++] = (Outcome_t) {0.5 * (1.0 - ch->pathPick), 0, 1, capFate(ch, f + 1)};
+			}
+			else {
+				out[n++] = (Outcome_t) {1.0, 1, 0, 0};
+			}
+			return n;
+		}
+		out[n++] = (Outcome_t) {1.0, 1, 0, 0};
+		return n;
+	default:
+		// Every 5★ counts on banners without rate-up items
+		out[n++] = (Outcome_t) {1.0, 1, 0, 0};
+		return n;
+	}
+}
+
+double getExactDist(const GachaState_t* st, const GachaConfig_t* cfg, const Session_t* ses, unsigned int k, unsigned int max, double* dist) {
+	Chain_t ch;
+	Outcome_t out[4];
+	unsigned int fateCnt, size, i, n, o, cnt, p, p2, g, g2, f, f2, c;
+	unsigned int minIdx, maxIdx;
+	double* cur;
+	double* next;
+	double* tmp;
+	double w[PITY_CNT];
+	double m, rest;
+	if (st == NULL || cfg == NULL || ses == NULL || dist == NULL) return -1;
+	if (k == 0 || ses->pb.banner >= WISH_CNT) return -1;
+	memset(&ch, 0, sizeof(ch));
+	ch.banner = ses->pb.banner;
+	ch.radiance = cfg->doRadiance > 0;
+	ch.path = st->epitomizedPath;
+	ch.epitomized = getEpitomized(cfg, &ses->pb);
+	if (ch.banner == WPN && ch.path) {
+		ch.pathUp = ((ses->pb.fiveUp[0] == ch.path) + (ses->pb.fiveUp[1] == ch.path)) / 2.0;
+	}
+	if (ch.banner == CHRONICLED) {
+		minIdx = 0;
+		maxIdx = ses->pb.fiveChrCnt;
+		if (ch.path >= 10000) {
+			minIdx = ses->pb.fiveChrCnt;
+			maxIdx += ses->pb.fiveWpnCnt;
+		}
+		cnt = 0;
+		for (i = minIdx; i < maxIdx; i++) {
+			if (ses->pb.five[i] == ch.path) cnt++;
+		}
+		if (maxIdx > minIdx) ch.pathPick = (double) cnt / (maxIdx - minIdx);
+	}
+	for (p = 0; p < PITY_CNT; p++) {
+		w[p] = getPullWeight(cfg, ses->pb.banner, p, 5);
+		if (w[p] > 1.0) w[p] = 1.0;
+		if (w[p] < 0.0) w[p] = 0.0;
+	}
+	fateCnt = ch.epitomized + 1;
+	size = PITY_CNT * 2 * fateCnt * k;
+	cur = calloc(size, sizeof(double));
+	next = calloc(size, sizeof(double));
+	if (cur == NULL || next == NULL) {
+		free(cur);
+		free(next);
+		return -1;
+	}
+#define IDX(p, g, f, c) ((((c) * fateCnt + (f)) * 2 + (g)) * PITY_CNT + (p))
+	cur[IDX(st->pity[1], st->getRateUp[1] ? 1 : 0, capFate(&ch, st->fatePoints), 0)] = 1.0;
+	rest = 1.0;
+	dist[0] = 0.0;
+	for (n = 1; n <= max; n++) {
+		dist[n] = 0.0;
+		memset(next, 0, size * sizeof(double));
+		for (c = 0; c < k; c++) for (f = 0; f < fateCnt; f++) for (g = 0; g < 2; g++) for (p = 0; p < PITY_CNT; p++) {
+			m = cur[IDX(p, g, f, c)];
+			if (m == 0.0) continue;
+			// Per-wish overrides at the top of doAPull_r
+			g2 = cfg->do5050 == 0 ? 0 : cfg->do5050 < 0 ? 1 : g;
+			f2 = ch.epitomized == 0 ? 0 : f;
+			if (ses->pb.banner == NOVICE && n - 1 == 7 - ses->noviceCnt) {
+				// Fixed 4★ drop, see doAWish
+				next[IDX((p + 1) % PITY_CNT, g2, f2, c)] += m;
+				continue;
+			}
+			p2 = cfg->doPity[1] ? (p + 1) % PITY_CNT : p;
+			if (w[p2] < 1.0) next[IDX(p2, g2, f2, c)] += m * (1.0 - w[p2]);
+			if (w[p2] == 0.0) continue;
+			cnt = resolveFive(&ch, g2, f2, out);
+			for (o = 0; o < cnt; o++) {
+				if (!out[o].target) {
+					next[IDX(0, out[o].getRateUp, out[o].fatePoints, c)] += m * w[p2] * out[o].p;
+				}
+				else if (c + 1 == k) {
+					dist[n] += m * w[p2] * out[o].p;
+				}
+				else {
+					next[IDX(0, out[o].getRateUp, out[o].fatePoints, c + 1)] += m * w[p2] * out[o].p;
+				}
+			}
+		}
+#undef IDX
+		tmp = cur;
+		cur = next;
+		next = tmp;
+		rest -= dist[n];
+	}
+	free(cur);
+	free(next);
+	return rest < 0.0 ? 0.0 : rest;
+}
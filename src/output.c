@@ -0,0 +1,126 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <stdio.h>
+#include <string.h>
+#include "output.h"
+#include "stats.h"
+#include "util.h"
+
+const char* const formats[FMT_CNT][2] = {
+	[FMT_TEXT] = {"text", _N("Human-readable text")},
+	[FMT_CSV] = {"csv", _N("Comma-separated values")},
+	[FMT_JSONL] = {"jsonl", _N("One JSON object per line")},
+	[FMT_BIN] = {"bin", _N("Packed 8-byte binary records")},
+};
+
+// Longest possible record, which is a JSON line with every field at its maximum
+#define MAX_RECORD_LEN 128
+
+static const char csvHeader[] = "pull,item,rarity,rate_up,pity4,pity5,fate_points\n";
+
+static inline char* putStr(char* p, const char* s, size_t len) {
+	memcpy(p, s, len);
+	return p + len;
+}
+
+static inline char* putUInt(char* p, unsigned int v) {
+	char tmp[10];
+	unsigned int n = 0;
+	do {
+		tmp[n++] = '0' + v % 10;
+		v /= 10;
+	} while (v);
+	while (n) {
+		*p++ = tmp[--n];
+	}
+	return p;
+}
+
+int outBegin(OutBuf_t* out, FILE* f, unsigned int format) {
+	if (format >= FMT_CNT) return -1;
+	out->f = f;
+	out->format = format;
+	out->len = 0;
+	if (format == FMT_CSV) {
+		out->len = sizeof(csvHeader) - 1;
+		memcpy(out->buf, csvHeader, out->len);
+	}
+	return 0;
+}
+
+int outFlush(OutBuf_t* out) {
+	if (out->len == 0) return 0;
+	if (PROF(PHASE_WRITE, fwrite(out->buf, 1, out->len, out->f)) != out->len) return -1;
+	out->len = 0;
+	return 0;
+}
+
+#define PUT_LIT(p, s) putStr(p, s, sizeof(s) - 1)
+
+// Writes a record at p, giving where it ends, or NULL for an unknown format
+static char* putRecord(char* p, unsigned int format, const PullRecord_t* rec) {
+	switch (format) {
+	case FMT_CSV:
+		p = putUInt(p, rec->pull);
+		*p++ = ',';
+		p = putUInt(p, rec->item);
+		*p++ = ',';
+		p = putUInt(p, rec->rare);
+		*p++ = ',';
+		p = putUInt(p, rec->isRateUp);
+		*p++ = ',';
+		p = putUInt(p, rec->pity[0]);
+		*p++ = ',';
+		p = putUInt(p, rec->pity[1]);
+		*p++ = ',';
+		p = putUInt(p, rec->fatePoints);
+		*p++ = '\n';
+		break;
+	case FMT_JSONL:
+		p = PUT_LIT(p, "{\"pull\":");
+		p = putUInt(p, rec->pull);
+		p = PUT_LIT(p, ",\"item\":");
+		p = putUInt(p, rec->item);
+		p = PUT_LIT(p, ",\"rarity\":");
+		p = putUInt(p, rec->rare);
+		p = PUT_LIT(p, ",\"rateUp\":");
+		p = putUInt(p, rec->isRateUp);
+		p = PUT_LIT(p, ",\"pity4\":");
+		p = putUInt(p, rec->pity[0]);
+		p = PUT_LIT(p, ",\"pity5\":");
+		p = putUInt(p, rec->pity[1]);
+		p = PUT_LIT(p, ",\"fatePoints\":");
+		p = putUInt(p, rec->fatePoints);
+		p = PUT_LIT(p, "}\n");
+		break;
+	case FMT_BIN:
+		p[0] = rec->item & 0xff;
+		p[1] = rec->item >> 8;
+		p[2] = rec->rare;
+		p[3] = rec->isRateUp;
+		p[4] = rec->pity[0];
+		p[5] = rec->pity[1];
+		p[6] = rec->fatePoints;
+		p[7] = 0;
+		p += BIN_RECORD_SIZE;
+		break;
+	default:
+		return NULL;
+	}
+	return p;
+}
+
+int outRecord(OutBuf_t* out, const PullRecord_t* rec) {
+	char* p;
+	if (out->len + MAX_RECORD_LEN > OUT_BUF_SIZE) {
+		if (outFlush(out) < 0) return -1;
+	}
+	p = PROF(PHASE_RENDER, putRecord(out->buf + out->len, out->format, rec));
+	if (p == NULL) return -1;
+	out->len = p - out->buf;
+	return 0;
+}
@@ -0,0 +1,318 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "yagiws.h"
+#include "util.h"
+#include "server.h"
+#include "stats.h"
+
+// Wishes are made and written out this many at a time
+#define SERVE_CHUNK 1024
+
+// Parts of a request that aren't account options
+typedef struct {
+	unsigned int pulls;
+	unsigned int binary;
+	unsigned int names;
+} ServeRequest_t;
+
+static const char* const openErrors[] = {
+	[-YG_EBANNER] = "banner didn't run in that version",
+	[-YG_EVERSION] = "invalid banner version or phase",
+	[-YG_EPITY] = "pity or fate points out of range",
+	[-YG_EPATH] = "invalid epitomized_path",
+	[-YG_ERNG] = "unable to seed the generator",
+};
+
+static int parseNum(const char* s, unsigned long long* n) {
+	char* p;
+	if (*s == '\0') return -1;
+	errno = 0;
+	*n = strtoull(s, &p, 0);
+	return (*p != '\0' || errno != 0) ? -1 : 0;
+}
+
+// Turns "M.m.p" into 0xMmp, or "M.m" into 0xMm if only 2 parts are wanted
+static int parseVersion(const char* s, unsigned int parts, unsigned int* ver) {
+	int v[3] = {0, 0, 1};
+	int n = sscanf(s, "%i.%i.%i", &v[0], &v[1], &v[2]);
+	if (n < 2 || (parts == 2 && n > 2)) return -1;
+	if (parts == 2) {
+		*ver = (v[0] & 0xf) << 4 | (v[1] & 0xf);
+	}
+	else *ver = (v[0] & 0xf) << 8 | (v[1] & 0xf) << 4 | (v[2] & 0xf);
+	return 0;
+}
+
+// Returns NULL if the request is fine, or the reason it isn't
+static const char* parseRequest(char* line, YgOptions_t* o, ServeRequest_t* rq) {
+	const struct {
+		const char* key;
+		unsigned int* field;
+	} nums[] = {
+		{"pulls", &rq->pulls},
+		{"pity4", &o->pity[0]},
+		{"pity5", &o->pity[1]},
+		{"smooth4c", &o->pityS[0]},
+		{"smooth4w", &o->pityS[1]},
+		{"smooth5c", &o->pityS[2]},
+		{"smooth5w", &o->pityS[3]},
+		{"fate_points", &o->fatePoints},
+		{"noviceCnt", &o->noviceCnt},
+	};
+	char* save;
+	char* word;
+	char* val;
+	unsigned long long n;
+	unsigned int i;
+	int ret;
+	ygDefaults(o);
+	rq->pulls = 10;
+	rq->binary = 0;
+	rq->names = 0;
+	for (word = strtok_r(line, " \t\r\n", &save); word != NULL; word = strtok_r(NULL, " \t\r\n", &save)) {
+		val = strchr(word, '=');
+		if (val == NULL) {
+			if (strcmp(word, "lostRateUp4") == 0) o->guaranteed[0] = 1;
+			else if (strcmp(word, "lostRateUp5") == 0) o->guaranteed[1] = 1;
+			else if (strcmp(word, "noSmooth4") == 0) o->doSmooth[0] = 0;
+			else if (strcmp(word, "noSmooth5") == 0) o->doSmooth[1] = 0;
+			else if (strcmp(word, "noPity4") == 0) o->doPity[0] = 0;
+			else if (strcmp(word, "noPity5") == 0) o->doPity[1] = 0;
+			else if (strcmp(word, "noGuarantee") == 0) o->do5050 = 0;
+			else if (strcmp(word, "rateUpOnly") == 0) o->do5050 = -1;
+			else if (strcmp(word, "forceSmoothChar") == 0) o->forceSmooth |= 1;
+			else if (strcmp(word, "forceSmoothWpn") == 0) o->forceSmooth |= 2;
+			else if (strcmp(word, "noSmoothOld") == 0) o->oldSmooth = 1;
+			else if (strcmp(word, "binary") == 0) rq->binary = 1;
+			else if (strcmp(word, "names") == 0) rq->names = 1;
+			else return "unknown flag";
+			continue;
+		}
+		*val++ = '\0';
+		if (strcmp(word, "banner") == 0) {
+			ret = ygBannerType(val);
+			if (ret < 0) return "unknown banner";
+			o->banner = ret;
+		}
+		else if (strcmp(word, "banner_version") == 0) {
+			if (parseVersion(val, 3, &o->version) < 0) return "invalid banner_version";
+		}
+		else if (strcmp(word, "pool_version") == 0) {
+			if (parseVersion(val, 2, &o->poolVersion) < 0) return "invalid pool_version";
+		}
+		else if (strcmp(word, "rng") == 0) {
+			for (i = 0; i < RNG_CNT; i++) {
+				if (strcasecmp(val, rngNames[i][0]) == 0) break;
+			}
+			if (i >= RNG_CNT) return "unknown rng";
+			o->rng = i;
+		}
+		else if (strcmp(word, "seed") == 0) {
+			if (parseNum(val, &o->seed) < 0) return "seed must be numeric";
+			o->seeded = 1;
+		}
+		else if (strcmp(word, "epitomized_path") == 0) {
+			// Same as -e: an index starting at 1, checked against the banner by ygOpen
+			if (parseNum(val, &n) < 0 || n < 1 || n > UINT_MAX) return "invalid epitomized_path";
+			o->epitomizedPath = n;
+		}
+		else if (strcmp(word, "radiance") == 0) {
+			if (strcasecmp(val, "on") == 0) o->doRadiance = 1;
+			else if (strcasecmp(val, "off") == 0) o->doRadiance = 0;
+			else if (strcasecmp(val, "auto") == 0) o->doRadiance = -1;
+			else return "radiance must be on, off or auto";
+		}
+		else {
+			for (i = 0; i < sizeof(nums) / sizeof(nums[0]); i++) {
+				if (strcmp(word, nums[i].key) == 0) break;
+			}
+			if (i >= sizeof(nums) / sizeof(nums[0])) return "unknown key";
+			if (parseNum(val, &n) < 0 || n > UINT_MAX) return "value must be numeric";
+			*nums[i].field = n;
+		}
+	}
+	if (rq->pulls > SERVE_PULLS_MAX) return "too many pulls";
+	return NULL;
+}
+
+// Gives the index of the charted item as given to epitomized_path, or 0 if there's none
+static unsigned int pathIndex(const YgAccount_t* acct, unsigned int banner, unsigned int item) {
+	const unsigned short* items;
+	unsigned int i, cnt, chrCnt, wpnCnt;
+	if (item == 0) return 0;
+	if (banner == YG_WPN) cnt = ygRateUp(acct, 5, &items);
+	else if (banner == YG_CHRONICLED) cnt = ygPool(acct, 5, &items, &chrCnt, &wpnCnt);
+	else return 0;
+	for (i = 0; i < cnt; i++) {
+		if (items[i] == item) return i + 1;
+	}
+	return 0;
+}
+
+static void serveConnection(int fd) {
+	char line[SERVE_LINE_MAX];
+	YgPacked_t res[SERVE_CHUNK];
+	YgAccount_t acct;
+	YgOptions_t o;
+	YgState_t st;
+	ServeRequest_t rq;
+	const char* err;
+	const char* name;
+	unsigned char le[4];
+	unsigned int i, n, done;
+	int ret, c;
+	FILE* in = fdopen(fd, "r");
+	FILE* out = NULL;
+	if (in == NULL) {
+		close(fd);
+		return;
+	}
+	ret = dup(fd);
+	if (ret < 0 || (out = fdopen(ret, "w")) == NULL) {
+		if (ret >= 0) close(ret);
+		fclose(in);
+		return;
+	}
+	while (fgets(line, SERVE_LINE_MAX, in) != NULL) {
+		if (strchr(line, '\n') == NULL && !feof(in)) {
+			// Throw away the rest of an overlong line
+			while ((c = getc(in)) != EOF && c != '\n');
+			err = "request too long";
+		}
+		else if (line[strspn(line, " \t\r\n")] == '\0') continue;
+		else {
+			err = parseRequest(line, &o, &rq);
+			if (err == NULL) {
+				ret = ygOpen(&acct, &o);
+				if (ret < 0) err = openErrors[-ret];
+			}
+		}
+		if (err != NULL) {
+			fprintf(out, "ERR %s\n", err);
+			if (fflush(out) != 0) break;
+			continue;
+		}
+		fprintf(out, "OK %u\n", rq.pulls);
+		ygGetState(&acct, &st);
+		for (done = 0; done < rq.pulls; done += n) {
+			n = rq.pulls - done < SERVE_CHUNK ? rq.pulls - done : SERVE_CHUNK;
+			ygWishPacked(&acct, res, n, &st);
+			for (i = 0; i < n; i++) {
+				if (rq.binary) {
+					le[0] = res[i];
+					le[1] = res[i] >> 8;
+					le[2] = res[i] >> 16;
+					le[3] = res[i] >> 24;
+					fwrite(le, 1, 4, out);
+					continue;
+				}
+				fprintf(out, "%u,%u,%u,%u", done + i + 1, YG_ITEM(res[i]), YG_RARE(res[i]), YG_RATEUP(res[i]));
+				if (rq.names) {
+					name = ygItemName(YG_ITEM(res[i]));
+					fprintf(out, ",%s", name != NULL ? name : "");
+				}
+				putc('\n', out);
+			}
+			if (ferror(out)) break;
+		}
+		fprintf(out, "STATE pity4=%u pity5=%u smooth4c=%u smooth4w=%u smooth5c=%u smooth5w=%u fate_points=%u",
+			st.pity[0], st.pity[1], st.pityS[0], st.pityS[1], st.pityS[2], st.pityS[3], st.fatePoints);
+		i = pathIndex(&acct, o.banner, st.epitomizedPath);
+		if (i) fprintf(out, " epitomized_path=%u", i);
+		if (o.banner == YG_NOVICE) {
+			fprintf(out, " noviceCnt=%u", o.noviceCnt < 8 && st.wishNo < 8 - o.noviceCnt ? o.noviceCnt + st.wishNo : 8);
+		}
+		fprintf(out, "%s%s\n", st.guaranteed[0] ? " lostRateUp4" : "", st.guaranteed[1] ? " lostRateUp5" : "");
+		if (fflush(out) != 0) break;
+	}
+	fclose(out);
+	fclose(in);
+}
+
+static void* serveWorker(void* arg) {
+	int lfd = *(const int*) arg;
+	int fd;
+	const struct timeval timeout = {.tv_sec = SERVE_TIMEOUT};
+	while (1) {
+		fd = accept(lfd, NULL, NULL);
+		if (fd < 0) {
+			// Errors about a single connection or a lack of resources aren't fatal
+			if (errno == EINTR || errno == ECONNABORTED || errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) continue;
+			break;
+		}
+		// A worker serves one connection at a time, so idle or stalled clients must not keep it forever.
+		// When a read or write times out, stdio sees an error and serveConnection closes the connection.
+		if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0 || setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0) {
+			close(fd);
+			continue;
+		}
+		serveConnection(fd);
+	}
+	statsFlush();
+	return NULL;
+}
+
+int serve(const char* path, unsigned int threads) {
+	struct sockaddr_un addr;
+	struct stat sb;
+	pthread_t* t;
+	unsigned int i, j;
+	int fd, err;
+	if (threads == 0) threads = 1;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	// Clients that go away mid-reply must not take the server down with them
+	signal(SIGPIPE, SIG_IGN);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	// A socket left behind by an earlier server would make bind fail, but anything else at that path is left alone
+	if (lstat(path, &sb) == 0 && S_ISSOCK(sb.st_mode)) {
+		unlink(path);
+	}
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) return -1;
+	if (bind(fd, (const struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+		err = errno;
+		close(fd);
+		errno = err;
+		return -1;
+	}
+	t = malloc(threads * sizeof(pthread_t));
+	if (t == NULL) {
+		close(fd);
+		errno = ENOMEM;
+		return -1;
+	}
+	for (i = 0; i < threads; i++) {
+		if (pthread_create(&t[i], NULL, serveWorker, &fd) != 0) break;
+	}
+	err = i ? EIO : EAGAIN;
+	// Workers only stop when the listening socket fails
+	for (j = 0; j < i; j++) {
+		pthread_join(t[j], NULL);
+	}
+	free(t);
+	close(fd);
+	errno = err;
+	return -1;
+}
@@ -0,0 +1,141 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+const char* const drawNames[DRAW_CNT] = {
+	[DRAW_OTHER] = _N("other"),
+	[DRAW_RARITY] = _N("rarity roll"),
+	[DRAW_RATE_UP] = _N("50/50"),
+	[DRAW_RADIANCE] = _N("Capturing Radiance"),
+	[DRAW_STABLE] = _N("stable pity"),
+	[DRAW_POOL] = _N("pool pick"),
+};
+
+const char* const phaseNames[PHASE_CNT] = {
+	[PHASE_RNG] = _N("random draw"),
+	[PHASE_DROP] = _N("drop"),
+	[PHASE_LOOKUP] = _N("name lookup"),
+	[PHASE_RENDER] = _N("render"),
+	[PHASE_WRITE] = _N("write"),
+};
+
+#ifdef STATS
+_Thread_local Stats_t stats;
+_Thread_local unsigned int statsDraw;
+static Stats_t total;
+int profiling = 0;
+static unsigned long long profStartTicks;
+static struct timespec profStartTime;
+
+void statsFlush(void) {
+	unsigned long long* src = (unsigned long long*) &stats;
+	unsigned long long* dst = (unsigned long long*) &total;
+	unsigned int i;
+	for (i = 0; i < sizeof(Stats_t) / sizeof(unsigned long long); i++) {
+		if (src[i]) __atomic_fetch_add(&dst[i], src[i], __ATOMIC_RELAXED);
+	}
+	memset(&stats, 0, sizeof(stats));
+}
+
+void statsPrint(void) {
+	unsigned long long sum = 0;
+	unsigned int i, j;
+	statsFlush();
+	// Keeps the counters after the results when both go to a terminal
+	fflush(stdout);
+	for (i = 0; i < DRAW_CNT; i++) {
+		sum += total.words[i];
+	}
+	fprintf(stderr, _("\nEngine counters:\n\tRandom words: %llu\n"), sum);
+	for (i = 0; i < DRAW_CNT; i++) {
+		fprintf(stderr, _("\t\t%s: %llu\n"), gettext(drawNames[i]), total.words[i]);
+	}
+	fprintf(stderr, _("\tgetrandom() calls: %llu\n"), total.getrandom);
+	fprintf(stderr, _("\tDrops by banner type:\n"));
+	for (i = 0; i < WISH_CNT; i++) {
+		if (total.arms[0][i] + total.arms[1][i] + total.arms[2][i] == 0) continue;
+		fprintf(stderr, "\t\t%s:", banners[i][0]);
+		for (j = 0; j < 3; j++) {
+			fprintf(stderr, _(" %u★ %llu"), 5 - j, total.arms[j][i]);
+		}
+		fprintf(stderr, "\n");
+	}
+	fprintf(stderr, _("\tSoft pity hits: 5★ %llu, 4★ %llu\n"), total.softPity[1], total.softPity[0]);
+	fprintf(stderr, _("\tgetItem() calls: %llu\n"), total.getItem);
+}
+
+void profAdd(unsigned int phase, unsigned long long t) {
+	unsigned int k;
+	stats.latSum[phase] += t;
+	if (t < LAT_SUB * 2) {
+		stats.lat[phase][t]++;
+		return;
+	}
+	k = 63 - __builtin_clzll(t);
+	if (k > LAT_MAX_LOG) {
+		stats.lat[phase][LAT_BUCKETS - 1]++;
+		return;
+	}
+	stats.lat[phase][(k - 3) * LAT_SUB + ((t >> (k - 4)) & (LAT_SUB - 1))]++;
+}
+
+// Highest value that falls in a bucket
+static unsigned long long latBucketMax(unsigned int i) {
+	unsigned int k;
+	if (i < LAT_SUB * 2) return i;
+	k = i / LAT_SUB + 3;
+	return ((unsigned long long) (LAT_SUB + i % LAT_SUB + 1) << (k - 4)) - 1;
+}
+
+static unsigned long long latPercentile(const unsigned long long* hist, unsigned long long cnt, double p) {
+	unsigned long long seen = 0, rank = (unsigned long long) (cnt * p);
+	unsigned int i;
+	for (i = 0; i < LAT_BUCKETS; i++) {
+		seen += hist[i];
+		if (seen > rank) return latBucketMax(i);
+	}
+	return latBucketMax(LAT_BUCKETS - 1);
+}
+
+static double elapsedNs(const struct timespec* since) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - since->tv_sec) * 1e9 + (now.tv_nsec - since->tv_nsec);
+}
+
+static void profPrint(void) {
+	unsigned long long cnt;
+	double ns, scale;
+	unsigned int i, j;
+	statsFlush();
+	fflush(stdout);
+	// profNow units per nanosecond, measured over the whole run, and at least 10ms of it
+	while ((ns = elapsedNs(&profStartTime)) < 1e7);
+	scale = (profNow() - profStartTicks) / ns;
+	fprintf(stderr, _("\nLatency by phase, in ns (%.3f ticks per ns):\n"), scale);
+	fprintf(stderr, "\t%-16s %12s %10s %10s %10s %10s\n", _("phase"), _("count"), _("mean"), _("p50"), _("p99"), _("p99.9"));
+	for (i = 0; i < PHASE_CNT; i++) {
+		cnt = 0;
+		for (j = 0; j < LAT_BUCKETS; j++) {
+			cnt += total.lat[i][j];
+		}
+		if (cnt == 0) continue;
+		fprintf(stderr, "\t%-16s %12llu %10.1f %10.1f %10.1f %10.1f\n", gettext(phaseNames[i]), cnt, total.latSum[i] / scale / cnt, latPercentile(total.lat[i], cnt, 0.5) / scale, latPercentile(total.lat[i], cnt, 0.99) / scale, latPercentile(total.lat[i], cnt, 0.999) / scale);
+	}
+}
+
+void profStart(void) {
+	clock_gettime(CLOCK_MONOTONIC, &profStartTime);
+	profStartTicks = profNow();
+	profiling = 1;
+	atexit(profPrint);
+}
+#endif
@@ -0,0 +1,131 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "item.h"
+#include "summary.h"
+#include "util.h"
+
+#define ITEM_CNT 65536
+
+int summaryInit(Summary_t* sum, unsigned int hasRateUp, unsigned int fateMax) {
+	memset(sum, 0, sizeof(Summary_t));
+	sum->items = calloc(ITEM_CNT, sizeof(unsigned long long));
+	if (sum->items == NULL) return -1;
+	sum->hasRateUp = hasRateUp;
+	sum->fateMax = fateMax > FATE_MAX ? FATE_MAX : fateMax;
+	return 0;
+}
+
+void summaryFree(Summary_t* sum) {
+	free(sum->items);
+	sum->items = NULL;
+}
+
+static inline unsigned long long capAt(unsigned long long v, unsigned long long max) {
+	return v > max ? max : v;
+}
+
+static void endStreak(Summary_t* sum) {
+	if (sum->streak == 0) return;
+	if (sum->streakWon) sum->winStreak[capAt(sum->streak, STREAK_MAX)]++;
+	else sum->lossStreak[capAt(sum->streak, STREAK_MAX)]++;
+	sum->streak = 0;
+}
+
+void summaryAdd(Summary_t* sum, unsigned int item, unsigned int rare, unsigned int isRateUp, unsigned int pity5, unsigned int guaranteed, unsigned int fatePoints) {
+	unsigned int won;
+	sum->pulls++;
+	sum->since5++;
+	sum->since4++;
+	sum->rarity[rare > 5 ? 0 : rare]++;
+	sum->items[item & (ITEM_CNT - 1)]++;
+	if (rare == 4) {
+		sum->gap4[capAt(sum->since4, GAP_MAX)]++;
+		sum->since4 = 0;
+	}
+	if (rare != 5) return;
+	sum->gap5[capAt(sum->since5, GAP_MAX)]++;
+	sum->since5 = 0;
+	sum->landed5[pity5 & 0xff]++;
+	if (sum->fateMax) {
+		sum->fateAt[capAt(fatePoints, FATE_MAX)]++;
+		if (fatePoints >= sum->fateMax) {
+			sum->fateUsed++;
+			return;
+		}
+	}
+	if (!sum->hasRateUp) return;
+	if (guaranteed) {
+		sum->guaranteed++;
+		return;
+	}
+	won = isRateUp ? 1 : 0;
+	if (isRateUp >= 2) sum->radiance++;
+	if (sum->streak && sum->streakWon != won) endStreak(sum);
+	sum->streakWon = won;
+	sum->streak++;
+}
+
+static void printBuckets(FILE* f, const char* title, const unsigned long long* hist, unsigned int max, unsigned int capped) {
+	unsigned int i;
+	unsigned long long cnt = 0;
+	long double sum = 0;
+	for (i = 0; i <= max; i++) {
+		cnt += hist[i];
+	}
+	if (cnt == 0) return;
+	fprintf(f, "\n%s\n", title);
+	for (i = 0; i <= max; i++) {
+		if (hist[i] == 0) continue;
+		if (i == max && capped) {
+			fprintf(f, _("\t%u+: %llu (%.4Lf%%)\n"), i, hist[i], (long double) hist[i] * 100 / cnt);
+		}
+		else {
+			fprintf(f, _("\t%u: %llu (%.4Lf%%)\n"), i, hist[i], (long double) hist[i] * 100 / cnt);
+		}
+		sum += (long double) hist[i] * i;
+	}
+	fprintf(f, _("\tMean: %.4Lf\n"), sum / cnt);
+}
+
+void summaryPrint(Summary_t* sum, FILE* f) {
+	unsigned int i;
+	const char* name;
+	unsigned long long fives;
+	endStreak(sum);
+	fprintf(f, _("Summary of %llu wishes:\n"), sum->pulls);
+	for (i = 5; i >= 3; i--) {
+		fprintf(f, _("\t%u★: %llu (%.4Lf%%)\n"), i, sum->rarity[i], sum->pulls ? (long double) sum->rarity[i] * 100 / sum->pulls : 0.0l);
+	}
+	fprintf(f, _("\nItems obtained:\n"));
+	for (i = 0; i < ITEM_CNT; i++) {
+		if (sum->items[i] == 0) continue;
+		name = getItem(i);
+		if (name != NULL) {
+			fprintf(f, _("\t%s (id %u): %llu (%.4Lf%%)\n"), name, i, sum->items[i], (long double) sum->items[i] * 100 / sum->pulls);
+		}
+		else {
+			fprintf(f, _("\tid %u: %llu (%.4Lf%%)\n"), i, sum->items[i], (long double) sum->items[i] * 100 / sum->pulls);
+		}
+	}
+	printBuckets(f, _("Wishes between 5★ drops:"), sum->gap5, GAP_MAX, 1);
+	printBuckets(f, _("Wishes between 4★ drops:"), sum->gap4, GAP_MAX, 1);
+	printBuckets(f, _("5★ pity at each 5★ drop:"), sum->landed5, 255, 0);
+	if (sum->hasRateUp) {
+		printBuckets(f, _("Won 50/50 streak lengths:"), sum->winStreak, STREAK_MAX, 1);
+		printBuckets(f, _("Lost 50/50 streak lengths:"), sum->lossStreak, STREAK_MAX, 1);
+		fprintf(f, _("\nGuaranteed rate-up 5★ drops: %llu\n"), sum->guaranteed);
+		fprintf(f, _("50/50s won through Capturing Radiance: %llu\n"), sum->radiance);
+	}
+	if (sum->fateMax) {
+		fives = sum->rarity[5];
+		printBuckets(f, _("Fate Points held at each 5★ drop:"), sum->fateAt, FATE_MAX, 0);
+		fprintf(f, _("5★ drops decided by Fate Points: %llu (%.4Lf%%)\n"), sum->fateUsed, fives ? (long double) sum->fateUsed * 100 / fives : 0.0l);
+	}
+}
@@ -0,0 +1,173 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gacha.h"
+#include "batch.h"
+#include "stats.h"
+#include "trials.h"
+
+typedef struct {
+	pthread_t thread;
+	const GachaState_t* init;
+	const GachaConfig_t* cfg;
+	const Session_t* ses;
+	unsigned long long key;
+	unsigned long long first;
+	unsigned long long trials;
+	GachaState_t st;
+	TrialHist_t hist;
+	int ret;
+} TrialWorker_t;
+
+static int allocTrialHist(TrialHist_t* hist, unsigned int pulls) {
+	hist->pulls = pulls;
+	hist->trials = 0;
+	hist->firstFive = calloc(pulls + 1, sizeof(unsigned long long));
+	hist->rateUpFive = calloc(pulls + 1, sizeof(unsigned long long));
+	hist->fourStars = calloc(pulls + 1, sizeof(unsigned long long));
+	if (hist->firstFive == NULL || hist->rateUpFive == NULL || hist->fourStars == NULL) {
+		freeTrialHist(hist);
+		return -1;
+	}
+	return 0;
+}
+
+void freeTrialHist(TrialHist_t* hist) {
+	free(hist->firstFive);
+	free(hist->rateUpFive);
+	free(hist->fourStars);
+	hist->firstFive = NULL;
+	hist->rateUpFive = NULL;
+	hist->fourStars = NULL;
+}
+
+// Trials are simulated TRIAL_LANES at a time with the batch engine
+#define TRIAL_LANES 1024
+typedef struct {
+	Batch_t b;
+	unsigned short item[TRIAL_LANES];
+	unsigned char rare[TRIAL_LANES];
+	unsigned char isRateUp[TRIAL_LANES];
+	unsigned int first[TRIAL_LANES];
+	unsigned int rateUp[TRIAL_LANES];
+	unsigned int four[TRIAL_LANES];
+} TrialLanes_t;
+
+static void* trialWorker(void* arg) {
+	TrialWorker_t* w = arg;
+	TrialLanes_t* l;
+	unsigned long long t;
+	unsigned int i, j;
+	// Allocated here so that the histograms end up close to the thread using them
+	if (allocTrialHist(&w->hist, w->hist.pulls) < 0) {
+		w->ret = -1;
+		return NULL;
+	}
+	l = malloc(sizeof(TrialLanes_t));
+	if (l == NULL || batchInit(&l->b, TRIAL_LANES) < 0) {
+		free(l);
+		w->ret = -1;
+		return NULL;
+	}
+	for (t = 0; t < w->trials; t += l->b.n) {
+		l->b.n = w->trials - t < TRIAL_LANES ? w->trials - t : TRIAL_LANES;
+		for (j = 0; j < l->b.n; j++) {
+			w->st = *w->init;
+			rngSeedStream(&w->st.rng, w->init->rng.type, w->key, w->first + t + j);
+			batchLoad(&l->b, j, &w->st);
+			l->first[j] = 0;
+			l->rateUp[j] = 0;
+			l->four[j] = 0;
+		}
+		for (i = 0; i < w->hist.pulls; i++) {
+			batchWish(&l->b, w->cfg, w->ses, i, l->item, l->rare, l->isRateUp);
+			for (j = 0; j < l->b.n; j++) {
+				if (l->rare[j] == 5) {
+					if (!l->first[j]) l->first[j] = i + 1;
+					if (l->isRateUp[j]) l->rateUp[j]++;
+				}
+				else if (l->rare[j] == 4) l->four[j]++;
+			}
+		}
+		for (j = 0; j < l->b.n; j++) {
+			w->hist.firstFive[l->first[j]]++;
+			w->hist.rateUpFive[l->rateUp[j]]++;
+			w->hist.fourStars[l->four[j]]++;
+		}
+		w->hist.trials += l->b.n;
+	}
+	batchFree(&l->b);
+	free(l);
+	w->ret = 0;
+	statsFlush();
+	return NULL;
+}
+
+void seedTrial(GachaState_t* st, unsigned long long trial) {
+	unsigned long long key = rndWord_r(&st->rng);
+	rngSeedStream(&st->rng, st->rng.type, key, trial);
+}
+
+int runTrials(GachaState_t* st, const GachaConfig_t* cfg, const Session_t* ses, unsigned int pulls, unsigned long long firstTrial, unsigned long long trials, unsigned int threads, TrialHist_t* hist) {
+	TrialWorker_t* w;
+	unsigned int i, j, k;
+	unsigned long long key, next;
+	int ret = 0;
+	if (threads == 0) return -1;
+	if ((unsigned long long) threads > trials) threads = trials ? trials : 1;
+	if (allocTrialHist(hist, pulls) < 0) return -1;
+	// The states are cache-line aligned, which calloc doesn't guarantee
+	w = aligned_alloc(_Alignof(TrialWorker_t), threads * sizeof(TrialWorker_t));
+	if (w == NULL) {
+		freeTrialHist(hist);
+		return -1;
+	}
+	memset(w, 0, threads * sizeof(TrialWorker_t));
+	key = rndWord_r(&st->rng);
+	next = firstTrial;
+	for (i = 0; i < threads; i++) {
+		w[i].init = st;
+		w[i].cfg = cfg;
+		w[i].ses = ses;
+		w[i].key = key;
+		w[i].first = next;
+		w[i].trials = trials / threads + (i < trials % threads ? 1 : 0);
+		w[i].hist.pulls = pulls;
+		next += w[i].trials;
+		w[i].ret = -1;
+	}
+	for (i = 0; i < threads; i++) {
+		if (pthread_create(&w[i].thread, NULL, trialWorker, &w[i]) != 0) {
+			break;
+		}
+	}
+	// Reap whatever was started, even if not everything could be
+	for (j = 0; j < i; j++) {
+		pthread_join(w[j].thread, NULL);
+	}
+	if (i < threads) ret = -1;
+	for (j = 0; j < i; j++) {
+		if (w[j].ret < 0) {
+			ret = -1;
+			continue;
+		}
+		for (k = 0; k <= pulls; k++) {
+			hist->firstFive[k] += w[j].hist.firstFive[k];
+			hist->rateUpFive[k] += w[j].hist.rateUpFive[k];
+			hist->fourStars[k] += w[j].hist.fourStars[k];
+		}
+		hist->trials += w[j].hist.trials;
+	}
+	for (j = 0; j < threads; j++) {
+		freeTrialHist(&w[j].hist);
+	}
+	free(w);
+	if (ret < 0) freeTrialHist(hist);
+	return ret;
+}
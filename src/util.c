@@ -4,13 +4,214 @@
 /* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
 
 #include "config.h"
+#include <errno.h>
 #include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <sys/random.h>
 #include <limits.h>
+#include <string.h>
+#include "stats.h"
 #include "util.h"
 
-long double rndFloat() {
-	static long long rndBuf;
-	getrandom(&rndBuf, sizeof(long long), 0);
+const char* const rngNames[RNG_CNT][2] = {
+	[RNG_KERNEL] = {"kernel", _N("Kernel entropy pool (one syscall per draw)")},
+	[RNG_XOSHIRO] = {"xoshiro", _N("xoshiro256** (seeded once)")},
+	[RNG_PHILOX] = {"philox", _N("Philox4x32-10 (counter-based, one stream per trial)")},
+};
+
+// Fills buf from the kernel entropy pool, giving -1 with errno set if getrandom() fails
+static int getKernelBytes(void* buf, size_t len) {
+	size_t got = 0;
+	ssize_t n;
+	// getrandom() may return short reads if interrupted by a signal
+	while (got < len) {
+		n = getrandom((unsigned char*) buf + got, len - got, 0);
+		STAT_INC(getrandom);
+		if (n < 0) {
+			if (errno == EINTR) continue;
+			return -1;
+		}
+		got += n;
+	}
+	return 0;
+}
+
+// Draws can't report errors, and there's no sensible result to make up
+static void kernelFailed(void) {
+	fprintf(stderr, _("Unable to get random bytes from the kernel: %s\n"), strerror(errno));
+	abort();
+}
+
+static unsigned long long getKernelWord() {
+	unsigned long long ret = 0;
+	if (getKernelBytes(&ret, sizeof(ret)) < 0) kernelFailed();
+	return ret;
+}
+
+static unsigned long long splitmix64(unsigned long long* x) {
+	unsigned long long z = (*x += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+// Seeds the generator deterministically. The kernel engine has no state, so the seed is ignored there.
+void rngSeed(Rng_t* r, unsigned int type, unsigned long long seed) {
+	rngSeedStream(r, type, seed, 0);
+}
+
+// Stream n of a seed is independent of the other streams, so it can be used for trial n no matter which thread or process runs it.
+// Philox takes the seed as its key and the stream as the upper half of its counter, so streams never overlap.
+// xoshiro256** hashes the stream into the seed instead; overlaps are possible, but vanishingly unlikely.
+void rngSeedStream(Rng_t* r, unsigned int type, unsigned long long seed, unsigned long long stream) {
+	unsigned int i;
+	r->type = type < RNG_CNT ? type : RNG_XOSHIRO;
+	switch (r->type) {
+	case RNG_PHILOX:
+		r->s[0] = seed;
+		r->s[1] = stream;
+		r->s[2] = 0; // Counter, in words
+		r->s[3] = 0; // Second word of the current block
+		break;
+	default:
+		if (stream) seed ^= splitmix64(&stream);
+		for (i = 0; i < 4; i++) {
+			r->s[i] = splitmix64(&seed);
+		}
+		break;
+	}
+	r->bits = 0;
+	r->nbits = 0;
+	r->resvPos = 0;
+	r->resvLen = 0;
+}
+
+// Seeds the generator from the kernel entropy pool. Gives -1 for an unknown type, or with errno set if the kernel failed.
+int rngInit(Rng_t* r, unsigned int type) {
+	unsigned long long seed;
+	if (type >= RNG_CNT) return -1;
+	if (getKernelBytes(&seed, sizeof(seed)) < 0) return -1;
+	rngSeed(r, type, seed);
+	return 0;
+}
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3")
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+static void philoxBlock(const unsigned int ctr[4], const unsigned int key[2], unsigned int out[4]) {
+	unsigned int c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+	unsigned int k0 = key[0], k1 = key[1];
+	unsigned long long p0, p1;
+	unsigned int i;
+	for (i = 0; i < 10; i++) {
+		p0 = (unsigned long long) PHILOX_M0 * c0;
+		p1 = (unsigned long long) PHILOX_M1 * c2;
+		c0 = (unsigned int) (p1 >> 32) ^ c1 ^ k0;
+		c2 = (unsigned int) (p0 >> 32) ^ c3 ^ k1;
+		c1 = (unsigned int) p1;
+		c3 = (unsigned int) p0;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+// Each 128-bit block gives two words; the second one is kept for the next draw.
+static unsigned long long philoxWord(Rng_t* r) {
+	unsigned int ctr[4], key[2], out[4];
+	unsigned long long n = r->s[2]++;
+	if (n & 1) return r->s[3];
+	ctr[0] = (unsigned int) (n >> 1);
+	ctr[1] = (unsigned int) (n >> 33);
+	ctr[2] = (unsigned int) r->s[1];
+	ctr[3] = (unsigned int) (r->s[1] >> 32);
+	key[0] = (unsigned int) r->s[0];
+	key[1] = (unsigned int) (r->s[0] >> 32);
+	philoxBlock(ctr, key, out);
+	r->s[3] = out[2] | (unsigned long long) out[3] << 32;
+	return out[0] | (unsigned long long) out[1] << 32;
+}
+
+static unsigned long long rndRaw(Rng_t* r) {
+	switch (r->type) {
+	case RNG_KERNEL:
+	default:
+		return getKernelWord();
+	case RNG_XOSHIRO:
+		return xoshiroNext(r->s);
+	case RNG_PHILOX:
+		return philoxWord(r);
+	}
+}
+
+unsigned long long rndWord_r(Rng_t* r) {
+	STAT_INC(words[statsDraw]);
+	if (r->resvPos < r->resvLen) return r->resv[r->resvPos++];
+	return rndRaw(r);
+}
+
+// Tops the reserve up to RNG_RESV words in one go, which is a single getrandom() call for the kernel engine.
+// Words still come out in the order the generator made them, so seeded results don't change.
+void rngReserve(Rng_t* r) {
+	unsigned int i, left = r->resvLen - r->resvPos;
+	memmove(r->resv, r->resv + r->resvPos, left * sizeof(r->resv[0]));
+	r->resvPos = 0;
+	r->resvLen = RNG_RESV;
+	switch (r->type) {
+	case RNG_KERNEL:
+	default:
+		if (getKernelBytes(r->resv + left, (RNG_RESV - left) * sizeof(r->resv[0])) < 0) kernelFailed();
+		break;
+	case RNG_XOSHIRO:
+	case RNG_PHILOX:
+		for (i = left; i < RNG_RESV; i++) {
+			r->resv[i] = rndRaw(r);
+		}
+		break;
+	}
+}
+
+long double rndFloat_r(Rng_t* r) {
+	long long rndBuf = (long long) rndWord_r(r);
 	return fabsl((long double) rndBuf / (long double) LLONG_MAX);
 }
+
+unsigned long long rndFixed_r(Rng_t* r) {
+	return rndWord_r(r) >> 1;
+}
+
+// Lemire's multiply-shift: the high half of (32-bit draw × n) is the result.
+// Draws whose low half falls below 2^32 mod n are rejected, so every value is equally likely.
+// The modulo is only computed in that (rare, for small n) case.
+unsigned int rndBounded_r(Rng_t* r, unsigned int n) {
+	unsigned long long m = (rndWord_r(r) >> 32) * n;
+	unsigned int lo = (unsigned int) m;
+	unsigned int t;
+	if (lo < n) {
+		t = -n % n;
+		while (lo < t) {
+			m = (rndWord_r(r) >> 32) * n;
+			lo = (unsigned int) m;
+		}
+	}
+	return m >> 32;
+}
+
+// Coin flips and other small decisions only need a few bits, so serve them from a cached word.
+unsigned int rndBits_r(Rng_t* r, unsigned int k) {
+	unsigned int ret;
+	if (r->nbits < k) {
+		r->bits = rndWord_r(r);
+		r->nbits = 64;
+	}
+	ret = r->bits & ((1ull << k) - 1);
+	r->bits >>= k;
+	r->nbits -= k;
+	return ret;
+}
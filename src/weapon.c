@@ -339,7 +339,7 @@ static const char* const* const* const Weapons[6] = {
 	FiveStarWeapons,
 };
 
-const char* getWeapon(unsigned int _id) {
+const char* getWeaponUntranslated(unsigned int _id) {
 	if (_id / 10000 != 1) return NULL;
 	unsigned int type = (_id / 1000) % 10;
 	unsigned int stars = (_id / 100) % 10;
@@ -395,5 +395,10 @@ const char* getWeapon(unsigned int _id) {
 		break;
 	}
 	if (id >= maxId) return NULL;
-	return gettext(Weapons[stars][type][id]);
+	return Weapons[stars][type][id];
+}
+
+const char* getWeapon(unsigned int id) {
+	const char* ret = getWeaponUntranslated(id);
+	return ret != NULL ? gettext(ret) : NULL;
 }
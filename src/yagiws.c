@@ -9,11 +9,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #ifdef ENABLE_NLS
 #include <locale.h>
 #endif
 #include "gacha.h"
+#include "hwprof.h"
 #include "item.h"
+#include "jobs.h"
+#include "markov.h"
+#include "output.h"
+#include "server.h"
+#include "stats.h"
+#include "summary.h"
+#include "trials.h"
 #include "util.h"
 
 static int shouldBold(unsigned int rare, unsigned int banner, unsigned int rateUp) {
@@ -66,6 +75,11 @@ static void usage() {
 		"\t-d, --details           Shows the pool of avaliable items and then\n"
 		"\t                        \texits.\n"
 		"\t-p, --pulls             Specify the number of pulls to perform at once.\n"
+		"\t--ten_pull              Make the wishes in blocks of 10, like the\n"
+		"\t                        \tgame's 10-pull, rounding -p up to a\n"
+		"\t                        \tmultiple of 10. The results are the same\n"
+		"\t                        \tas with single wishes. Only affects the\n"
+		"\t                        \tnormal text output.\n"
 		"\t-4, --pity4             Specify initial 4★ pity.\n"
 		"\t-5, --pity5             Specify initial 5★ pity.\n"
 		"\t-l, --lostRateUp4       Specify that the next 4★ is guaranteed to be\n"
@@ -164,6 +178,98 @@ static void usage() {
 		"\t                        \tbehavior should be used that forces\n"
 		"\t                        \t\"smooth\" pity to be 50/50 between\n"
 		"\t                        \tcharacters and weapons.\n"
+		"\t--format                Choose how each wish is written out. Valid\n"
+		"\t                        \tformats:\n"
+		"\t                        \t"
+	));
+	for (i = 0; i < FMT_CNT; i++) {
+		printf("%s%s", i == 0 ? "" : ", ", formats[i][0]);
+	}
+	printf(_("\n"
+		"\t                        \tAll formats besides text write the item\n"
+		"\t                        \tid, rarity, rate-up flag, pity and Fate\n"
+		"\t                        \tPoints after each wish, without names.\n"
+		"\t--summary               Don't show each wish, only a summary of the\n"
+		"\t                        \tresults: rarity and item counts, gaps\n"
+		"\t                        \tbetween 5★ and 4★ drops, the pity each\n"
+		"\t                        \t5★ dropped at, 50/50 streaks and Fate\n"
+		"\t                        \tPoint usage.\n"
+		"\nRandom Number Generation:\n"
+		"\t--rng                   Choose the random number generator. Valid\n"
+		"\t                        \tgenerators:\n"
+		"\t                        \t"
+	));
+	for (i = 0; i < RNG_CNT; i++) {
+		printf("%s%s", i == 0 ? "" : ", ", rngNames[i][0]);
+	}
+	printf(_("\n"
+		"\t                        \t(Defaults to xoshiro.)\n"
+		"\t--seed                  Seed the random number generator with the\n"
+		"\t                        \tgiven value, making the results\n"
+		"\t                        \treproducible. Ignored by the kernel\n"
+		"\t                        \tgenerator.\n"
+		"\nMonte Carlo Simulation:\n"
+		"\t--trials                Simulate this many independent accounts, each\n"
+		"\t                        \tmaking the amount of wishes given by -p,\n"
+		"\t                        \tand only show histograms of the results.\n"
+		"\t--threads               Specify the number of threads to use with\n"
+		"\t                        \t--trials. Defaults to the number of\n"
+		"\t                        \tonline processors.\n"
+		"\t--first_trial           Number the trials starting from this value\n"
+		"\t                        \tinstead of 0. Every trial has its own\n"
+		"\t                        \trandom stream, so a run with the same\n"
+		"\t                        \t--seed can be split into shards this\n"
+		"\t                        \tway, and the thread count doesn't\n"
+		"\t                        \tchange the results.\n"
+		"\t--replay                Make the wishes of the given trial number\n"
+		"\t                        \tfrom a --trials run with the same\n"
+		"\t                        \t--seed, and show them like a normal run.\n"
+		"\nBatch Mode:\n"
+		"\t--jobs                  Read one run per line from the given file\n"
+		"\t                        \t(- for standard input), written with the\n"
+		"\t                        \tsame options as the command line, and\n"
+		"\t                        \tprint one record per run with the\n"
+		"\t                        \tamount of 5★ and 4★ items it got and its\n"
+		"\t                        \tfinal state. The runs are spread over\n"
+		"\t                        \t--threads threads, and the records are\n"
+		"\t                        \twritten in the order of the file, as CSV\n"
+		"\t                        \tor with --format=jsonl, JSON lines.\n"
+		"\nServer Mode:\n"
+		"\t--serve                 Listen on the given Unix socket path and\n"
+		"\t                        \tanswer wish requests until killed,\n"
+		"\t                        \tusing --threads threads. The request\n"
+		"\t                        \tformat is described in server.h.\n"
+		"\t                        \tConnections idle for 30 seconds are\n"
+		"\t                        \tclosed.\n"
+		"\t--exact[=k]             Instead of wishing, compute the exact chance of\n"
+		"\t                        \tgetting the k-th (default 1st) rate-up\n"
+		"\t                        \t5★ on each wish, starting from the given\n"
+		"\t                        \tstate. If an Epitomized or Chronicled\n"
+		"\t                        \tPath is charted, the charted item is\n"
+		"\t                        \ttargeted instead. On banners without\n"
+		"\t                        \trate-up items, any 5★ counts.\n"
+		"\nDiagnostics:\n"
+		"\t--stats                 Count what the simulation does during the\n"
+		"\t                        \trun: random words by what they were\n"
+		"\t                        \tdrawn for, getrandom() calls, drops by\n"
+		"\t                        \tbanner type, soft pity hits and item\n"
+		"\t                        \tname lookups, and print the counts to\n"
+		"\t                        \tstandard error on exit. Only available\n"
+		"\t                        \tif built with ./configure --enable-stats.\n"
+		"\t--profile               Time each random draw, drop, item name\n"
+		"\t                        \tlookup, render and write, and print the\n"
+		"\t                        \tmean, median, 99th and 99.9th percentile\n"
+		"\t                        \tlatency of each to standard error on exit.\n"
+		"\t                        \tOnly available if built with\n"
+		"\t                        \t./configure --enable-stats.\n"
+		"\t--profile-hw            Count CPU cycles, instructions, branch\n"
+		"\t                        \tmisses and L1d and LLC read misses\n"
+		"\t                        \twhile wishing, with --trials too, and\n"
+		"\t                        \tprint them per pull to standard error.\n"
+		"\t                        \tNeeds Linux and access to the hardware\n"
+		"\t                        \tcounters (see perf_event_paranoid);\n"
+		"\t                        \twithout them, a warning is printed and\n"
+		"\t                        \tthe run goes on.\n"
 		"\nDisclaimer:\n"
 		"This project is not affiliated with miHoYo/Hoyoverse/Cogonosphere or any of\n"
 		"their subsidiaries. It is designed for entertainment purposes only, and gacha\n"
@@ -172,6 +278,28 @@ static void usage() {
 	));
 }
 
+// Prints the non-empty buckets of a histogram, along with its mean.
+// If noneAtZero is set, bucket 0 counts trials where the event never happened and is excluded from the mean.
+static void printHist(const char* title, const unsigned long long* hist, unsigned int max, unsigned long long trials, unsigned int noneAtZero) {
+	unsigned int i;
+	unsigned long long cnt = 0;
+	long double sum = 0;
+	printf("\n%s\n", title);
+	for (i = 0; i <= max; i++) {
+		if (hist[i] == 0) continue;
+		if (i == 0 && noneAtZero) {
+			printf(_("\tNone: %llu (%.4Lf%%)\n"), hist[i], (long double) hist[i] * 100 / trials);
+			continue;
+		}
+		printf(_("\t%u: %llu (%.4Lf%%)\n"), i, hist[i], (long double) hist[i] * 100 / trials);
+		cnt += hist[i];
+		sum += (long double) hist[i] * i;
+	}
+	if (cnt) {
+		printf(_("\tMean: %.4Lf\n"), sum / cnt);
+	}
+}
+
 typedef struct option opt_t;
 
 static const opt_t long_opts[] = {
@@ -205,38 +333,83 @@ static const opt_t long_opts[] = {
 	{"noSmoothOld", no_argument, 0, 6},
 	{"epitomized_state", required_argument, 0, 'E'},
 	{"radiance", required_argument, 0, 'R'},
+	{"rng", required_argument, 0, 7},
+	{"seed", required_argument, 0, 8},
+	{"trials", required_argument, 0, 9},
+	{"threads", required_argument, 0, 10},
+	{"exact", optional_argument, 0, 11},
+	{"format", required_argument, 0, 12},
+	{"summary", no_argument, 0, 13},
+	{"first_trial", required_argument, 0, 14},
+	{"replay", required_argument, 0, 15},
+	{"ten_pull", no_argument, 0, 16},
+	{"serve", required_argument, 0, 17},
+	{"jobs", required_argument, 0, 18},
+	{"stats", no_argument, 0, 19},
+	{"profile", no_argument, 0, 20},
+	{"profile-hw", no_argument, 0, 21},
 	{NULL, 0, 0, 0},
 };
 
-int main(int argc, char** argv) {
-	unsigned int i;
-	static char buf[1024];
-	int item = 11301;
-	unsigned int rare = 3;
-	unsigned int color = 0;
-	unsigned int isChar = 0;
-	unsigned int won5050 = 0;
-	int banner = -1;
-	unsigned int pulls = 10;
-	unsigned int noviceCnt = 0;
-	unsigned int detailsRequested = 0;
-	unsigned int forceSmooth = 0;
-	unsigned int oldSmooth = 0;
-	int epitomizedPathIndex = -1;
-	unsigned int fiveMaxIdx, fourMaxIdx, fiveMinIdx, fourMinIdx;
-	const unsigned short* fivePool;
-	const unsigned short* fourPool;
+// Everything the options of a single run set up
+typedef struct {
+	int banner;
+	unsigned int pulls;
+	unsigned int noviceCnt;
+	unsigned int detailsRequested;
+	unsigned int forceSmooth;
+	unsigned int oldSmooth;
+	int epitomizedPathIndex;
+	unsigned int rngType;
+	unsigned int seedGiven;
+	unsigned long long seed;
+	unsigned long long trials;
+	unsigned long long firstTrial;
+	unsigned int replayGiven;
+	unsigned long long replay;
+	unsigned int tenPull;
+	const char* servePath;
+	const char* jobsPath;
+	unsigned int stats;
+	unsigned int profile;
+	unsigned int profileHw;
+	long threads;
+	unsigned int exactCnt;
+	unsigned int format;
+	unsigned int summary;
+	int v[4];
+	int b[5];
+	const ChroniclePool_t* ChroniclePool;
+	GachaState_t state;
+	GachaConfig_t cfg;
+	Session_t session;
+} Options_t;
+
+static void initOptions(Options_t* o) {
+	static const int v[4] = {-1, -1, 0, 0x53};
+	static const int b[5] = {-1, -1, -1, 0, 0x532};
+	memset(o, 0, sizeof(*o));
+	o->banner = -1;
+	o->pulls = 10;
+	o->epitomizedPathIndex = -1;
+	o->rngType = RNG_XOSHIRO;
+	o->format = FMT_TEXT;
+	memcpy(o->v, v, sizeof(v));
+	memcpy(o->b, b, sizeof(b));
+	initGachaState(&o->state);
+	initGachaConfig(&o->cfg);
+}
+
+// Parses the options of a single run, the same way on the command line and in a --jobs file (job set).
+// Returns 0 to go on with the run, 1 if there is nothing left to do (e.g. after --help) and -1 on errors.
+// Messages only go to stderr for a job, so that nothing gets mixed into the records on stdout.
+static int parseOptions(int argc, char** argv, Options_t* o, int job) {
 	int c = 0;
 	long long n = 0;
-	int v[4] = {-1, -1, 0, 0x53};
-	int b[5] = {-1, -1, -1, 0, 0x532};
 	char* p = NULL;
-	const ChroniclePool_t* ChroniclePool = NULL;
-#ifdef ENABLE_NLS
-	setlocale(LC_ALL, "");
-	bindtextdomain(PACKAGE, LOCALEDIR);
-	textdomain(PACKAGE);
-#endif
+	initOptions(o);
+	// Start over, in case an earlier run was parsed
+	optind = 0;
 	while (1) {
 		c = getopt_long(argc, argv, "4:5:B:CE:LNR:SV:Wb:c:de:f:ghlnrsp:v", long_opts, NULL);
 		if (c == -1) break;
@@ -257,7 +430,7 @@ int main(int argc, char** argv) {
 				fprintf(stderr, _("4★ pity must be numeric.\n"));
 				return -1;
 			}
-			pity[0] = n;
+			o->state.pity[0] = n;
 			break;
 		case '5':
 			n = strtoull(optarg, &p, 0);
@@ -275,38 +448,38 @@ int main(int argc, char** argv) {
 				fprintf(stderr, _("5★ pity must be numeric.\n"));
 				return -1;
 			}
-			pity[1] = n;
+			o->state.pity[1] = n;
 			break;
 		case 'B':
-			n = sscanf(optarg, "%i.%i.%i", &b[0], &b[1], &b[2]);
+			n = sscanf(optarg, "%i.%i.%i", &o->b[0], &o->b[1], &o->b[2]);
 			if (n == EOF || n == 0) {
-				fprintf(stderr, _("Unable to parse banner version, using %d.%d.%d\n"), b[4] >> 8, (b[4] >> 4) & 0xf, b[4] & 0xf);
+				fprintf(stderr, _("Unable to parse banner version, using %d.%d.%d\n"), o->b[4] >> 8, (o->b[4] >> 4) & 0xf, o->b[4] & 0xf);
 			}
-			b[3] = 1;
+			o->b[3] = 1;
 			if (n == 2) {
-				if (b[0] == (b[4] >> 8) && b[1] == ((b[4] >> 4) & 0xf)) {
-					b[2] = b[4] & 0xf;
+				if (o->b[0] == (o->b[4] >> 8) && o->b[1] == ((o->b[4] >> 4) & 0xf)) {
+					o->b[2] = o->b[4] & 0xf;
 				}
-				else b[2] = 1;
-				fprintf(stderr, _("Did not get banner phase, using %d.%d.%d\n"), b[0], b[1], b[2]);
+				else o->b[2] = 1;
+				fprintf(stderr, _("Did not get banner phase, using %d.%d.%d\n"), o->b[0], o->b[1], o->b[2]);
 			}
 			else if (n == 1) {
-				b[1] = (b[4] >> 4) & 0xf;
-				if (b[0] == (b[4] >> 8)) {
-					b[2] = b[4] & 0xf;
+				o->b[1] = (o->b[4] >> 4) & 0xf;
+				if (o->b[0] == (o->b[4] >> 8)) {
+					o->b[2] = o->b[4] & 0xf;
 				}
-				else b[2] = 1;
-				fprintf(stderr, _("Only got banner major version, using %d.0.%d\n"), b[0], b[2]);
+				else o->b[2] = 1;
+				fprintf(stderr, _("Only got banner major version, using %d.0.%d\n"), o->b[0], o->b[2]);
 			}
 #ifndef DEBUG
-			if (b[2] > ((b[0] == 1 && b[1] == 3) ? 4 : 2) || b[2] < 1) {
-				fprintf(stderr, _("Invalid banner phase %d (only 1%s accepted)\n"), b[2], (b[0] == 1 && b[1] == 3) ? _("-4") : _(" or 2"));
+			if (o->b[2] > ((o->b[0] == 1 && o->b[1] == 3) ? 4 : 2) || o->b[2] < 1) {
+				fprintf(stderr, _("Invalid banner phase %d (only 1%s accepted)\n"), o->b[2], (o->b[0] == 1 && o->b[1] == 3) ? _("-4") : _(" or 2"));
 				return -1;
 			}
 #endif
 			break;
 		case 'C':
-			forceSmooth |= 1;
+			o->forceSmooth |= 1;
 			break;
 		case 'E':
 			n = strtoull(optarg, &p, 0);
@@ -328,13 +501,13 @@ int main(int argc, char** argv) {
 				fprintf(stderr, _("Invalid argument for option \"--radiance\"\n"));
 				return -1;
 			}
-			doEpitomized = n;
+			o->cfg.doEpitomized = n;
 			break;
 		case 'L':
-			getRateUp[1] = 1;
+			o->state.getRateUp[1] = 1;
 			break;
 		case 'N':
-			doPity[1] = 0;
+			o->cfg.doPity[1] = 0;
 			break;
 		case 'R':
 			n = strtoull(optarg, &p, 0);
@@ -356,29 +529,29 @@ int main(int argc, char** argv) {
 				fprintf(stderr, _("Invalid argument for option \"--radiance\"\n"));
 				return -1;
 			}
-			doRadiance = n;
+			o->cfg.doRadiance = n;
 			break;
 		case 'S':
-			doSmooth[1] = 0;
+			o->cfg.doSmooth[1] = 0;
 			break;
 		case 'V':
-			n = sscanf(optarg, "%i.%i", &v[0], &v[1]);
+			n = sscanf(optarg, "%i.%i", &o->v[0], &o->v[1]);
 			if (n == EOF || n == 0) {
-				fprintf(stderr, _("Unable to parse pool version, using %d.%d\n"), v[3] >> 4, v[3] & 0xf);
+				fprintf(stderr, _("Unable to parse pool version, using %d.%d\n"), o->v[3] >> 4, o->v[3] & 0xf);
 			}
-			v[2] = 1;
+			o->v[2] = 1;
 			if (n == 1) {
-				fprintf(stderr, _("Only got major pool version, using %d.0\n"), v[0]);
-				v[1] = 0;
+				fprintf(stderr, _("Only got major pool version, using %d.0\n"), o->v[0]);
+				o->v[1] = 0;
 			}
 			break;
 		case 'W':
-			forceSmooth |= 2;
+			o->forceSmooth |= 2;
 			break;
 		case 'b':
 			for (n = 0; n < WISH_CNT; n++) {
 				if (strcasecmp(optarg, banners[n][0]) == 0) {
-					banner = n;
+					o->banner = n;
 					break;
 				}
 			}
@@ -405,10 +578,10 @@ int main(int argc, char** argv) {
 				fprintf(stderr, _("Wish count must be numeric.\n"));
 				return -1;
 			}
-			noviceCnt = n;
+			o->noviceCnt = n;
 			break;
 		case 'd':
-			detailsRequested = 1;
+			o->detailsRequested = 1;
 			break;
 		case 'e':
 			n = strtoull(optarg, &p, 0);
@@ -422,7 +595,7 @@ int main(int argc, char** argv) {
 				fprintf(stderr, _("Epitomized Path index must be numeric.\n"));
 				return -1;
 			}
-			epitomizedPathIndex = n;
+			o->epitomizedPathIndex = n;
 			break;
 		case 'f':
 			n = strtoull(optarg, &p, 0);
@@ -440,22 +613,22 @@ int main(int argc, char** argv) {
 				fprintf(stderr, _("Fate Points must be numeric.\n"));
 				return -1;
 			}
-			fatePoints = n;
+			o->state.fatePoints = n;
 			break;
 		case 'g':
-			do5050 = 0;
+			o->cfg.do5050 = 0;
 			break;
 		case 'l':
-			getRateUp[0] = 1;
+			o->state.getRateUp[0] = 1;
 			break;
 		case 'n':
-			doPity[0] = 0;
+			o->cfg.doPity[0] = 0;
 			break;
 		case 'r':
-			do5050 = -1;
+			o->cfg.do5050 = -1;
 			break;
 		case 's':
-			doSmooth[0] = 0;
+			o->cfg.doSmooth[0] = 0;
 			break;
 		case 'p':
 			n = strtoull(optarg, &p, 0);
@@ -467,7 +640,7 @@ int main(int argc, char** argv) {
 				fprintf(stderr, _("Pull count must be numeric.\n"));
 				return -1;
 			}
-			pulls = n;
+			o->pulls = n;
 			break;
 		case 1 ... 4:
 			n = strtoull(optarg, &p, 0);
@@ -482,18 +655,139 @@ int main(int argc, char** argv) {
 				return -1;
 			}
 			// TODO minor sanity checks, similar to main pity
-			pityS[c - 1] = n;
+			o->state.pityS[c - 1] = n;
 			break;
 		case 6:
-			oldSmooth = 1;
+			o->oldSmooth = 1;
+			break;
+		case 7:
+			for (n = 0; n < RNG_CNT; n++) {
+				if (strcasecmp(optarg, rngNames[n][0]) == 0) {
+					o->rngType = n;
+					break;
+				}
+			}
+			if (n >= RNG_CNT) {
+				fprintf(stderr, _("Invalid random number generator \"%s\". Valid generators:\n"), optarg);
+				for (n = 0; n < RNG_CNT; n++) {
+					fprintf(stderr, _("\t%s: %s\n"), rngNames[n][0], gettext(rngNames[n][1]));
+				}
+				return -1;
+			}
+			break;
+		case 8:
+			o->seed = strtoull(optarg, &p, 0);
+			if ((unsigned long) optarg == (unsigned long) p) {
+				fprintf(stderr, _("Seed must be numeric.\n"));
+				return -1;
+			}
+			o->seedGiven = 1;
+			break;
+		case 9:
+			o->trials = strtoull(optarg, &p, 0);
+			if ((unsigned long) optarg == (unsigned long) p) {
+				fprintf(stderr, _("Trial count must be numeric.\n"));
+				return -1;
+			}
+			break;
+		case 10:
+			n = strtoull(optarg, &p, 0);
+			if ((unsigned long) optarg == (unsigned long) p) {
+				fprintf(stderr, _("Thread count must be numeric.\n"));
+				return -1;
+			}
+			if (n < 1) {
+				fprintf(stderr, _("Thread count must be at least 1.\n"));
+				return -1;
+			}
+			o->threads = n;
+			break;
+		case 11:
+			n = 1;
+			if (optarg != NULL) {
+				n = strtoull(optarg, &p, 0);
+				if ((unsigned long) optarg == (unsigned long) p) {
+					fprintf(stderr, _("Rate-up count must be numeric.\n"));
+					return -1;
+				}
+				if (n < 1 || n > 100) {
+					fprintf(stderr, _("Rate-up count must be between 1 and 100.\n"));
+					return -1;
+				}
+			}
+			o->exactCnt = n;
+			break;
+		case 13:
+			o->summary = 1;
+			break;
+		case 14:
+			o->firstTrial = strtoull(optarg, &p, 0);
+			if ((unsigned long) optarg == (unsigned long) p) {
+				fprintf(stderr, _("Trial number must be numeric.\n"));
+				return -1;
+			}
+			break;
+		case 15:
+			o->replay = strtoull(optarg, &p, 0);
+			if ((unsigned long) optarg == (unsigned long) p) {
+				fprintf(stderr, _("Trial number must be numeric.\n"));
+				return -1;
+			}
+			o->replayGiven = 1;
+			break;
+		case 16:
+			o->tenPull = 1;
+			break;
+		case 17:
+			o->servePath = optarg;
+			break;
+		case 18:
+			o->jobsPath = optarg;
+			break;
+		case 19:
+#ifdef STATS
+			o->stats = 1;
+			break;
+#else
+			fprintf(stderr, _("--stats is only available if built with ./configure --enable-stats.\n"));
+			return -1;
+#endif
+		case 20:
+#ifdef STATS
+			o->profile = 1;
+			break;
+#else
+			fprintf(stderr, _("--profile is only available if built with ./configure --enable-stats.\n"));
+			return -1;
+#endif
+		case 21:
+			o->profileHw = 1;
+			break;
+		case 12:
+			for (n = 0; n < FMT_CNT; n++) {
+				if (strcasecmp(optarg, formats[n][0]) == 0) {
+					o->format = n;
+					break;
+				}
+			}
+			if (n >= FMT_CNT) {
+				fprintf(stderr, _("Invalid output format \"%s\". Valid formats:\n"), optarg);
+				for (n = 0; n < FMT_CNT; n++) {
+					fprintf(stderr, _("\t%s: %s\n"), formats[n][0], gettext(formats[n][1]));
+				}
+				return -1;
+			}
 			break;
 		case 'v':
-			ver();
-			return 0;
 		case 'h':
 		case 5:
-			usage();
-			return 0;
+			if (job) {
+				fprintf(stderr, _("-h, --help and -v can't be used in a --jobs file.\n"));
+				return -1;
+			}
+			if (c == 'v') ver();
+			else usage();
+			return 1;
 		case '?':
 			fprintf(stderr, _("Try '%s --help' for more information.\n"), program_invocation_name);
 			return -1;
@@ -506,11 +800,17 @@ int main(int argc, char** argv) {
 		fprintf(stderr, _("Try '%s --help' for more information.\n"), program_invocation_name);
 		return -1;
 	}
-	if (optind <= 1) {
+	if (optind <= 1 && !job) {
 		usage();
-		return 0;
+		return 1;
 	}
-	if (banner < 0) {
+	return 0;
+}
+
+// Checks the parsed options against each other, and resolves the banner version, pools and initial state.
+static int resolveOptions(Options_t* o) {
+	long long n;
+	if (o->banner < 0) {
 		fprintf(stderr, _("We need a banner to pull from!\nValid banner indexes:\n"));
 		for (n = 0; n < WISH_CNT; n++) {
 			fprintf(stderr, _("\t%s: %s\n"), banners[n][0], gettext(banners[n][1]));
@@ -519,184 +819,275 @@ int main(int argc, char** argv) {
 		return -1;
 	}
 #ifndef DEBUG
-	if (banner == WPN || banner == STD_WPN) {
-		if (pity[0] >= 10) {
+	if (o->banner == WPN || o->banner == STD_WPN) {
+		if (o->state.pity[0] >= 10) {
 			fprintf(stderr, _("4★ pity cannot be more than 10 for weapon banners.\n"));
 			return -1;
 		}
-		if (pity[1] >= 80) {
+		if (o->state.pity[1] >= 80) {
 			fprintf(stderr, _("5★ pity cannot be more than 80 for weapon banners.\n"));
 			return -1;
 		}
 	}
 #endif
-	if (b[3]) {
+	if (o->b[3]) {
 #ifndef DEBUG
-		b[4] = (((b[0] & 0xf) << 8) | ((b[1] & 0xf) << 4) | (b[2] & 0xf));
+		o->b[4] = (((o->b[0] & 0xf) << 8) | ((o->b[1] & 0xf) << 4) | (o->b[2] & 0xf));
 #else
-		b[4] = ((b[0] << 8) | (b[1] << 4) | b[2]);
+		o->b[4] = ((o->b[0] << 8) | (o->b[1] << 4) | o->b[2]);
 #endif
 	}
-	b[0] = b[4] & 0xf;
-	b[0]--;
-	b[1] = b[4] >> 4;
+	o->b[0] = getBannerIndex(o->banner, o->b[4]);
 #ifndef DEBUG
-	if (b[1] > 0x54) b[1] = 0x54;
-#endif
-	if (b[1] >= 0x50) {
-		b[1] -= 0x7;
-	}
-	if (b[1] >= 0x40) {
-		b[1] -= 0x7;
-	}
-	if (b[1] >= 0x30) {
-		b[1] -= 0x7;
-	}
-	if (b[1] >= 0x20) {
-		b[1] -= 0x9;
-	}
-	if (b[1] >= 0x14) {
-		b[1] += 0x1;
+	// Versions before 1.0 give negative indexes, which must not reach the banner tables
+	if ((o->b[4] >> 8) < 1 || o->b[0] < 0 || o->b[0] >= IDX_MAX * 2) {
+		fprintf(stderr, _("Error: No banners ran during version %d.%d phase %d\n"), (o->b[4] >> 8 & 0xf), (o->b[4] >> 4) & 0xf, o->b[4] & 0xf);
+		return -1;
 	}
-	b[1] -= 0x10;
-#ifdef DEBUG
-	if (banner == CHRONICLED) {
-#else
-	if (1) {
 #endif
-		if (b[1] > IDX_MAX - 1) {
-			b[1] = IDX_MAX - 1;
-		}
-	}
-	b[0] += (b[1] << 1);
-	if (banner == CHRONICLED) {
-		ChroniclePool = getChroniclePool(b[0]);
-		if (ChroniclePool == NULL) {
-			fprintf(stderr, _("Error: Chronicled Wish didn't run during version %d.%d phase %d\n"), (b[4] >> 8 & 0xf), (b[4] >> 4) & 0xf, b[4] & 0xf);
+	if (o->banner == CHRONICLED) {
+		o->ChroniclePool = getChroniclePool(o->b[0]);
+		if (o->ChroniclePool == NULL) {
+			fprintf(stderr, _("Error: Chronicled Wish didn't run during version %d.%d phase %d\n"), (o->b[4] >> 8 & 0xf), (o->b[4] >> 4) & 0xf, o->b[4] & 0xf);
 			return -1;
 		}
-		fivePool = ChroniclePool->FiveStarPool;
-#ifndef DEBUG
-		fiveMaxIdx = ChroniclePool->FiveStarWeaponCount + ChroniclePool->FiveStarCharCount;
-#endif
-	}
-	if (doEpitomized < 0) {
-		// TODO Check b[0] instead
-		if (b[4] > 0x500 || banner == CHRONICLED) {
-			doEpitomized = 1;
-		}
-		else if ((b[4] < 0x200 && doEpitomized == -1) || banner != WPN) {
-			doEpitomized = 0;
-		}
-		else {
-			doEpitomized = 2;
-		}
-	}
-	if (doRadiance < 0) {
-		// TODO Check b[0] instead
-		if (b[4] > 0x500) {
-			doRadiance = 1;
-		}
-		else {
-			doRadiance = 0;
-		}
 	}
+	resolveGachaConfig(&o->cfg, o->banner, o->b[4]);
 #ifndef DEBUG
 	if (
 		(
-			banner == WPN && (epitomizedPathIndex > 2)
+			o->banner == WPN && (o->epitomizedPathIndex > 2)
 		) || (
-			banner == CHRONICLED && (epitomizedPathIndex > (int) fiveMaxIdx)
+			o->banner == CHRONICLED && (o->epitomizedPathIndex > (int) (o->ChroniclePool->FiveStarWeaponCount + o->ChroniclePool->FiveStarCharCount))
 		)
 	) {
 		fprintf(stderr, _("Epitomized Path index is invalid.\n"));
 		return -1;
 	}
 #endif
-	if (epitomizedPathIndex > 0) {
-		epitomizedPathIndex--;
-		if (banner == WPN) {
-			epitomizedPath = FiveStarWpnUp[b[0]][epitomizedPathIndex];
+	if (o->epitomizedPathIndex > 0) {
+		o->epitomizedPathIndex--;
+		if (o->banner == WPN) {
+			o->state.epitomizedPath = FiveStarWpnUp[o->b[0]][o->epitomizedPathIndex];
 		}
-		else if (banner == CHRONICLED) {
-			epitomizedPath = fivePool[epitomizedPathIndex];
+		else if (o->banner == CHRONICLED) {
+			o->state.epitomizedPath = o->ChroniclePool->FiveStarPool[o->epitomizedPathIndex];
 		}
 	}
-	if (!(banner == STD_CHR || banner == STD_WPN) && do5050 < 0) {
-		v[2] = 0;
-		v[3] = 0;
+	if (!(o->banner == STD_CHR || o->banner == STD_WPN) && o->cfg.do5050 < 0) {
+		o->v[2] = 0;
+		o->v[3] = 0;
 	}
-	if (v[2]) {
+	if (o->v[2]) {
 #ifndef DEBUG
-		v[3] = ((v[0] & 0xf) << 4 | (v[1] & 0xf));
+		o->v[3] = ((o->v[0] & 0xf) << 4 | (o->v[1] & 0xf));
 #else
-		v[3] = (v[0] << 4 | v[1]);
+		o->v[3] = (o->v[0] << 4 | o->v[1]);
 #endif
 	}
 	else {
-		v[3] = b[4] >> 4;
+		o->v[3] = o->b[4] >> 4;
 	}
-	v[0] = v[3];
+	o->v[0] = getPoolIndex(o->banner, o->v[3]);
 #ifndef DEBUG
-	if (banner == NOVICE) {
-#else
-	if (0) {
-#endif
-		v[0] = 0;
+	if (o->banner == CHAR2 && FiveStarChrUp[o->b[0]][1] == 0xffff) {
+		fprintf(stderr, _("Warning: Character Event Banner-2 didn't run during version %d.%d phase %d, switching to main Character Event Banner\n"), (o->b[4] >> 8 & 0xf), (o->b[4] >> 4) & 0xf, o->b[4] & 0xf);
+		o->banner = CHAR1;
 	}
-	else {
-#ifndef DEBUG
-		if (v[0] > 0x54) v[0] = 0x54;
 #endif
-		if (v[0] >= 0x50) {
-			v[0] -= 0x7;
+	if ((o->forceSmooth & 3) == 3) {
+		fprintf(stderr, _("Both characters and weapons specified as forced. Reverting to normal behavior.\n"));
+		o->forceSmooth = 0;
+	}
+	if (o->seedGiven) {
+		if (o->rngType == RNG_KERNEL) {
+			fprintf(stderr, _("Warning: The kernel random number generator can't be seeded, ignoring seed.\n"));
 		}
-		if (v[0] >= 0x40) {
-			v[0] -= 0x7;
+		rngSeed(&o->state.rng, o->rngType, o->seed);
+	}
+	else if (rngInit(&o->state.rng, o->rngType) < 0) {
+		fprintf(stderr, _("Unable to seed the random number generator: %s\n"), strerror(errno));
+		return -1;
+	}
+	if (o->replayGiven) {
+		if (o->trials) {
+			fprintf(stderr, _("--replay can't be used with --trials.\n"));
+			return -1;
 		}
-		if (v[0] >= 0x30) {
-			v[0] -= 0x7;
+		seedTrial(&o->state, o->replay);
+	}
+	if (o->oldSmooth) {
+		if (o->cfg.doSmooth[0] == 0) {
+			o->cfg.doSmooth[0] = -1;
 		}
-		if (v[0] >= 0x20) {
-			v[0] -= 0x9;
+		if (o->cfg.doSmooth[1] == 0) {
+			o->cfg.doSmooth[1] = -1;
 		}
-		v[0] -= 0xf;
-#ifndef DEBUG
-		if ((int) v[0] < 1) v[0] = 1;
-		if (v[0] > IDX_MAX) v[0] = IDX_MAX;
-#endif
 	}
-#ifndef DEBUG
-	if (FiveStarChrUp[b[0]][1] == 0xffff && banner == CHAR2) {
-		fprintf(stderr, _("Warning: Character Event Banner-2 didn't run during version %d.%d phase %d, switching to main Character Event Banner\n"), (b[4] >> 8 & 0xf), (b[4] >> 4) & 0xf, b[4] & 0xf);
-		banner = CHAR1;
+	return 0;
+}
+
+// Prepares the banner of a resolved run
+static int prepareSession(Options_t* o) {
+	if (prepareBanner(&o->session.pb, o->banner, o->v[0], o->b[0]) < 0) return -1;
+	selectKernel(&o->session.pb, &o->cfg);
+	o->session.noviceCnt = o->noviceCnt;
+	o->session.forceSmooth = o->forceSmooth;
+	return 0;
+}
+
+// Reads the runs of a --jobs file, JOB_BATCH lines at a time, runs each batch on a worker pool and writes out its records
+static int runJobFile(const char* path, long threads, unsigned int format) {
+	static char line[JOB_LINE_MAX];
+	static Options_t jo;
+	char* argv[JOB_ARGS_MAX + 2];
+	char* word;
+	char* save;
+	unsigned int i, argc, lineNo = 0, cnt, failed = 0;
+	int ret, eof = 0;
+	Job_t* jobs;
+	JobPool_t pool;
+	FILE* f = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+	if (f == NULL) {
+		fprintf(stderr, _("Unable to open %s: %s\n"), path, strerror(errno));
+		return -1;
 	}
-#endif
-	if ((forceSmooth & 3) == 3) {
-		fprintf(stderr, _("Both characters and weapons specified as forced. Reverting to normal behavior.\n"));
-		forceSmooth = 0;
+	if (threads <= 0) {
+		threads = sysconf(_SC_NPROCESSORS_ONLN);
+		if (threads <= 0) threads = 1;
 	}
-	if (oldSmooth) {
-		if (doSmooth[0] == 0) {
-			doSmooth[0] = -1;
+	// The states are cache-line aligned, which malloc doesn't guarantee
+	jobs = aligned_alloc(_Alignof(Job_t), JOB_BATCH * sizeof(Job_t));
+	if (jobs == NULL || jobPoolStart(&pool, threads) < 0) {
+		fprintf(stderr, _("Unable to start the worker threads.\n"));
+		free(jobs);
+		if (f != stdin) fclose(f);
+		return -1;
+	}
+	jobBegin(stdout, format);
+	while (!eof) {
+		for (cnt = 0; cnt < JOB_BATCH;) {
+			if (fgets(line, JOB_LINE_MAX, f) == NULL) {
+				eof = 1;
+				break;
+			}
+			lineNo++;
+			if (strchr(line, '\n') == NULL && !feof(f)) {
+				fprintf(stderr, _("Line %u of %s is too long, skipping it.\n"), lineNo, path);
+				while (fgets(line, JOB_LINE_MAX, f) != NULL && strchr(line, '\n') == NULL);
+				failed++;
+				continue;
+			}
+			argv[0] = program_invocation_name;
+			argc = 1;
+			for (word = strtok_r(line, " \t\r\n", &save); word != NULL && argc <= JOB_ARGS_MAX; word = strtok_r(NULL, " \t\r\n", &save)) {
+				argv[argc++] = word;
+			}
+			// Blank lines and comments
+			if (argc == 1 || argv[1][0] == '#') continue;
+			if (word != NULL) {
+				fprintf(stderr, _("Line %u of %s has too many options, skipping it.\n"), lineNo, path);
+				failed++;
+				continue;
+			}
+			argv[argc] = NULL;
+			ret = parseOptions(argc, argv, &jo, 1);
+			if (ret == 0 && (jo.detailsRequested || jo.trials || jo.exactCnt || jo.summary || jo.servePath || jo.jobsPath || jo.stats || jo.profile || jo.profileHw)) {
+				fprintf(stderr, _("-d, --trials, --exact, --summary, --serve, --jobs, --stats, --profile and --profile-hw can't be used in a --jobs file.\n"));
+				ret = -1;
+			}
+			if (ret != 0 || resolveOptions(&jo) < 0 || prepareSession(&jo) < 0) {
+				fprintf(stderr, _("Unable to run line %u of %s, skipping it.\n"), lineNo, path);
+				failed++;
+				continue;
+			}
+			jobs[cnt].st = jo.state;
+			jobs[cnt].cfg = jo.cfg;
+			jobs[cnt].ses = jo.session;
+			jobs[cnt].line = lineNo;
+			jobs[cnt].pulls = jo.pulls;
+			cnt++;
 		}
-		if (doSmooth[1] == 0) {
-			doSmooth[1] = -1;
+		jobPoolRun(&pool, jobs, cnt);
+		for (i = 0; i < cnt; i++) {
+			jobRecord(stdout, format, &jobs[i]);
 		}
+		fflush(stdout);
+	}
+	jobPoolStop(&pool);
+	free(jobs);
+	if (f != stdin) fclose(f);
+	if (ferror(stdout)) {
+		fprintf(stderr, _("Unable to write the results: %s\n"), strerror(errno));
+		return -1;
 	}
-	if (detailsRequested) {
-		if ((banner == CHAR1 || banner == CHAR2 || banner == WPN || banner == CHRONICLED) && b[3]) {
-			printf(_("Details for the %s banner from v%d.%d phase %d:"), gettext(banners[banner][1]), b[4] >> 8, (b[4] >> 4) & 0xf, b[4] & 0xf);
+	return failed ? -1 : 0;
+}
+
+int main(int argc, char** argv) {
+	unsigned int i;
+	static char buf[1024];
+	int item = 11301;
+	unsigned int rare = 3;
+	unsigned int color = 0;
+	unsigned int isChar = 0;
+	const char* name;
+	unsigned int won5050 = 0;
+	PullResult_t ten[10];
+	TrialHist_t hist;
+	unsigned int horizon;
+	double* dist;
+	double rest, cdf, mean;
+	static OutBuf_t out;
+	PullRecord_t rec;
+	unsigned int pity5;
+	unsigned int guaranteed;
+	unsigned int fate;
+	Summary_t sum;
+	unsigned int fiveMaxIdx, fourMaxIdx, fiveMinIdx, fourMinIdx;
+	const unsigned short* fivePool;
+	const unsigned short* fourPool;
+	long long n = 0;
+	static Options_t o;
+	int ret;
+#ifdef ENABLE_NLS
+	setlocale(LC_ALL, "");
+	bindtextdomain(PACKAGE, LOCALEDIR);
+	textdomain(PACKAGE);
+#endif
+	ret = parseOptions(argc, argv, &o, 0);
+	if (ret != 0) return ret < 0 ? -1 : 0;
+#ifdef STATS
+	if (o.stats) atexit(statsPrint);
+	if (o.profile) profStart();
+#endif
+	if (o.servePath != NULL) {
+		if (o.threads <= 0) {
+			o.threads = sysconf(_SC_NPROCESSORS_ONLN);
+			if (o.threads <= 0) o.threads = 1;
+		}
+		fprintf(stderr, _("Serving requests on %s using %ld threads\n"), o.servePath, o.threads);
+		serve(o.servePath, o.threads);
+		fprintf(stderr, _("Unable to serve requests on %s: %s\n"), o.servePath, strerror(errno));
+		return -1;
+	}
+	if (o.jobsPath != NULL) {
+		return runJobFile(o.jobsPath, o.threads, o.format);
+	}
+	if (resolveOptions(&o) < 0) return -1;
+	if (o.detailsRequested) {
+		if ((o.banner == CHAR1 || o.banner == CHAR2 || o.banner == WPN || o.banner == CHRONICLED) && o.b[3]) {
+			printf(_("Details for the %s banner from v%d.%d phase %d:"), gettext(banners[o.banner][1]), o.b[4] >> 8, (o.b[4] >> 4) & 0xf, o.b[4] & 0xf);
 		}
 		else {
-			printf(_("Details for the %s banner:"), gettext(banners[banner][1]));
+			printf(_("Details for the %s banner:"), gettext(banners[o.banner][1]));
 		}
-		if (!(banner == NOVICE || banner == CHRONICLED) && v[2]) {
-			printf(_(" (v%d.%d standard pool)"), v[3] >> 4, v[3] & 0xf);
+		if (!(o.banner == NOVICE || o.banner == CHRONICLED) && o.v[2]) {
+			printf(_(" (v%d.%d standard pool)"), o.v[3] >> 4, o.v[3] & 0xf);
 		}
 		printf("\n\n");
-		if (banner == CHAR1 || banner == CHAR2) {
-			item = FiveStarChrUp[b[0]][banner - CHAR1];
+		if (o.banner == CHAR1 || o.banner == CHAR2) {
+			item = FiveStarChrUp[o.b[0]][o.banner - CHAR1];
 			if (getItem(item) != NULL) {
 				snprintf(buf, 1024, _("\e[33;1m%s\e[39;0m (id %u)"), getItem(item), item);
 			}
@@ -706,7 +1097,7 @@ int main(int argc, char** argv) {
 			printf(_("Rate-Up 5★ Character:\n\t%s\n\n"), buf);
 			printf(_("Rate-Up 4★ Characters:\n"));
 			for (n = 0; n < 3; n++) {
-				item = FourStarChrUp[b[0]][n];
+				item = FourStarChrUp[o.b[0]][n];
 				if (getItem(item) != NULL) {
 					snprintf(buf, 1024, _("\e[35;1m%s\e[39;0m (id %u)"), getItem(item), item);
 				}
@@ -717,10 +1108,10 @@ int main(int argc, char** argv) {
 			}
 			printf("\n");
 		}
-		else if (banner == WPN) {
+		else if (o.banner == WPN) {
 			printf(_("Rate-Up 5★ Weapons:\n"));
 			for (n = 0; n < 2; n++) {
-				item = FiveStarWpnUp[b[0]][n];
+				item = FiveStarWpnUp[o.b[0]][n];
 				if (getItem(item) != NULL) {
 					snprintf(buf, 1024, _("\e[33;1m%s\e[39;0m (id %u)"), getItem(item), item);
 				}
@@ -732,7 +1123,7 @@ int main(int argc, char** argv) {
 			printf(_("(Chart a course by passing -e x, where x is the desired index listed above.)\n\n"));
 			printf(_("Rate-Up 4★ Weapons:\n"));
 			for (n = 0; n < 5; n++) {
-				item = FourStarWpnUp[b[0]][n];
+				item = FourStarWpnUp[o.b[0]][n];
 				if (getItem(item) != NULL) {
 					snprintf(buf, 1024, _("\e[35;1m%s\e[39;0m (id %u)"), getItem(item), item);
 				}
@@ -743,25 +1134,25 @@ int main(int argc, char** argv) {
 			}
 			printf("\n");
 		}
-		if (banner != WPN && banner != STD_WPN && do5050 >= 0) {
+		if (o.banner != WPN && o.banner != STD_WPN && o.cfg.do5050 >= 0) {
 			printf(_("5★ Character Pool:\n"));
-			if (banner == CHRONICLED) {
-				fivePool = ChroniclePool->FiveStarPool;
-				fiveMaxIdx = ChroniclePool->FiveStarCharCount;
+			if (o.banner == CHRONICLED) {
+				fivePool = o.ChroniclePool->FiveStarPool;
+				fiveMaxIdx = o.ChroniclePool->FiveStarCharCount;
 			}
 			else {
 				fivePool = FiveStarChr;
-				fiveMaxIdx = FiveStarMaxIndex[v[0]];
+				fiveMaxIdx = FiveStarMaxIndex[o.v[0]];
 			}
 			for (n = 0; n < fiveMaxIdx; n++) {
 				item = fivePool[n];
 				if (getItem(item) != NULL) {
-					snprintf(buf, 1024, _("\e[33%sm%s\e[39;0m (id %u)"), shouldBold(5, banner, banner == CHRONICLED) ? ";1" : ";22", getItem(item), item);
+					snprintf(buf, 1024, _("\e[33%sm%s\e[39;0m (id %u)"), shouldBold(5, o.banner, o.banner == CHRONICLED) ? ";1" : ";22", getItem(item), item);
 				}
 				else {
-					snprintf(buf, 1024, _("id \e[33%sm%u\e[39;0m"), shouldBold(5, banner, banner == CHRONICLED) ? ";1" : ";22", item);
+					snprintf(buf, 1024, _("id \e[33%sm%u\e[39;0m"), shouldBold(5, o.banner, o.banner == CHRONICLED) ? ";1" : ";22", item);
 				}
-				if (banner == CHRONICLED) {
+				if (o.banner == CHRONICLED) {
 					printf(_("\t%d: %s\n"), (int) n + 1, buf);
 				}
 				else {
@@ -770,12 +1161,12 @@ int main(int argc, char** argv) {
 			}
 			printf("\n");
 		}
-		if (banner != CHAR1 && banner != CHAR2 && banner != NOVICE && banner != STD_ONLY_CHR && do5050 >= 0) {
+		if (o.banner != CHAR1 && o.banner != CHAR2 && o.banner != NOVICE && o.banner != STD_ONLY_CHR && o.cfg.do5050 >= 0) {
 			printf(_("5★ Weapon Pool:\n"));
-			if (banner == CHRONICLED) {
-				fivePool = ChroniclePool->FiveStarPool;
-				fiveMinIdx = ChroniclePool->FiveStarCharCount;
-				fiveMaxIdx = ChroniclePool->FiveStarWeaponCount + fiveMinIdx;
+			if (o.banner == CHRONICLED) {
+				fivePool = o.ChroniclePool->FiveStarPool;
+				fiveMinIdx = o.ChroniclePool->FiveStarCharCount;
+				fiveMaxIdx = o.ChroniclePool->FiveStarWeaponCount + fiveMinIdx;
 			}
 			else {
 				fivePool = FiveStarWpn;
@@ -785,12 +1176,12 @@ int main(int argc, char** argv) {
 			for (n = fiveMinIdx; n < fiveMaxIdx; n++) {
 				item = fivePool[n];
 				if (getItem(item) != NULL) {
-					snprintf(buf, 1024, _("\e[33%sm%s\e[39;0m (id %u)"), shouldBold(5, banner, banner == CHRONICLED) ? ";1" : ";22", getItem(item), item);
+					snprintf(buf, 1024, _("\e[33%sm%s\e[39;0m (id %u)"), shouldBold(5, o.banner, o.banner == CHRONICLED) ? ";1" : ";22", getItem(item), item);
 				}
 				else {
-					snprintf(buf, 1024, _("id \e[33%sm%u\e[39;0m"), shouldBold(5, banner, banner == CHRONICLED) ? ";1" : ";22", item);
+					snprintf(buf, 1024, _("id \e[33%sm%u\e[39;0m"), shouldBold(5, o.banner, o.banner == CHRONICLED) ? ";1" : ";22", item);
 				}
-				if (banner == CHRONICLED) {
+				if (o.banner == CHRONICLED) {
 					printf(_("\t%d: %s\n"), (int) n + 1, buf);
 				}
 				else {
@@ -798,43 +1189,43 @@ int main(int argc, char** argv) {
 				}
 			}
 			printf("\n");
-			if (banner == CHRONICLED) {
+			if (o.banner == CHRONICLED) {
 				printf(_("(Chart a course by passing -e x, where x is the desired index listed above.)\n\n"));
 			}
 		}
-		if (do5050 >= 0) {
+		if (o.cfg.do5050 >= 0) {
 			printf(_("4★ Character Pool:\n"));
-			if (banner == CHRONICLED) {
-				fourPool = ChroniclePool->FourStarPool;
-				fourMaxIdx = ChroniclePool->FourStarCharCount;
+			if (o.banner == CHRONICLED) {
+				fourPool = o.ChroniclePool->FourStarPool;
+				fourMaxIdx = o.ChroniclePool->FourStarCharCount;
 				fourMinIdx = 0;
 			}
 			else {
 				fourPool = FourStarChr;
-				fourMaxIdx = FourStarMaxIndex[v[0]] + 3;
+				fourMaxIdx = FourStarMaxIndex[o.v[0]] + 3;
 				fourMinIdx = 0;
-				if (!(banner == STD_CHR || banner == STD_ONLY_CHR || banner == STD_WPN)) {
+				if (!(o.banner == STD_CHR || o.banner == STD_ONLY_CHR || o.banner == STD_WPN)) {
 					fourMinIdx = 3;
 				}
 			}
 			for (n = fourMinIdx; n < fourMaxIdx; n++) {
 				item = fourPool[n];
 				if (getItem(item) != NULL) {
-					snprintf(buf, 1024, _("\e[35%sm%s\e[39;0m (id %u)"), shouldBold(4, banner, 0) ? ";1" : ";22", getItem(item), item);
+					snprintf(buf, 1024, _("\e[35%sm%s\e[39;0m (id %u)"), shouldBold(4, o.banner, 0) ? ";1" : ";22", getItem(item), item);
 				}
 				else {
-					snprintf(buf, 1024, _("id \e[35%sm%u\e[39;0m"), shouldBold(4, banner, 0) ? ";1" : ";22", item);
+					snprintf(buf, 1024, _("id \e[35%sm%u\e[39;0m"), shouldBold(4, o.banner, 0) ? ";1" : ";22", item);
 				}
 				printf("\t%s\n", buf);
 			}
 			printf("\n");
 		}
-		if (banner != NOVICE && do5050 >= 0) {
+		if (o.banner != NOVICE && o.cfg.do5050 >= 0) {
 			printf(_("4★ Weapon Pool:\n"));
-			if (banner == CHRONICLED) {
-				fourPool = ChroniclePool->FourStarPool;
-				fourMinIdx = ChroniclePool->FourStarCharCount;
-				fourMaxIdx = ChroniclePool->FourStarWeaponCount + fourMinIdx;
+			if (o.banner == CHRONICLED) {
+				fourPool = o.ChroniclePool->FourStarPool;
+				fourMinIdx = o.ChroniclePool->FourStarCharCount;
+				fourMaxIdx = o.ChroniclePool->FourStarWeaponCount + fourMinIdx;
 			}
 			else {
 				fourPool = FourStarWpn;
@@ -844,16 +1235,16 @@ int main(int argc, char** argv) {
 			for (n = fourMinIdx; n < fourMaxIdx; n++) {
 				item = fourPool[n];
 				if (getItem(item) != NULL) {
-					snprintf(buf, 1024, _("\e[35%sm%s\e[39;0m (id %u)"), shouldBold(4, banner, 0) ? ";1" : ";22", getItem(item), item);
+					snprintf(buf, 1024, _("\e[35%sm%s\e[39;0m (id %u)"), shouldBold(4, o.banner, 0) ? ";1" : ";22", getItem(item), item);
 				}
 				else {
-					snprintf(buf, 1024, _("id \e[35%sm%u\e[39;0m"), shouldBold(4, banner, 0) ? ";1" : ";22", item);
+					snprintf(buf, 1024, _("id \e[35%sm%u\e[39;0m"), shouldBold(4, o.banner, 0) ? ";1" : ";22", item);
 				}
 				printf("\t%s\n", buf);
 			}
 			printf("\n");
 		}
-		if (do5050 >= 0) {
+		if (o.cfg.do5050 >= 0) {
 			printf(_("3★ Weapon Pool:\n"));
 			for (n = 0; n < 13; n++) {
 				item = ThreeStar[n];
@@ -868,43 +1259,146 @@ int main(int argc, char** argv) {
 		}
 		return 0;
 	}
-	if ((banner == CHAR1 || banner == CHAR2 || banner == WPN || banner == CHRONICLED) && b[3]) {
-	fprintf(stderr, _("Making %u wishes on the %s banner from v%d.%d phase %d"), pulls, gettext(banners[banner][1]), b[4] >> 8, (b[4] >> 4) & 0xf, b[4] & 0xf);
+	if ((o.banner == CHAR1 || o.banner == CHAR2 || o.banner == WPN || o.banner == CHRONICLED) && o.b[3]) {
+	fprintf(stderr, _("Making %u wishes on the %s banner from v%d.%d phase %d"), o.pulls, gettext(banners[o.banner][1]), o.b[4] >> 8, (o.b[4] >> 4) & 0xf, o.b[4] & 0xf);
 	}
 	else {
-		fprintf(stderr, _("Making %u wishes on the %s banner"), pulls, gettext(banners[banner][1]));
+		fprintf(stderr, _("Making %u wishes on the %s banner"), o.pulls, gettext(banners[o.banner][1]));
+	}
+	if (!(o.banner == NOVICE || o.banner == CHRONICLED) && o.v[2]) {
+		fprintf(stderr, _(" (v%d.%d standard pool)"), o.v[3] >> 4, o.v[3] & 0xf);
+	}
+	if (o.replayGiven) {
+		fprintf(stderr, _(", replaying trial %llu"), o.replay);
+	}
+	if (prepareSession(&o) < 0) {
+		fprintf(stderr, _("\nUnable to prepare the banner.\n"));
+		return -1;
+	}
+	if (o.exactCnt) {
+		// Long enough for every path to the target with pity enabled, and for the tail to vanish without it
+		horizon = o.exactCnt * 90 * (o.cfg.doEpitomized + 2);
+		if (!o.cfg.doPity[1]) horizon *= 64;
+		if (horizon < o.pulls) horizon = o.pulls;
+		dist = malloc((horizon + 1) * sizeof(double));
+		if (dist == NULL) {
+			fprintf(stderr, _("Unable to compute the distribution.\n"));
+			return -1;
+		}
+		rest = getExactDist(&o.state, &o.cfg, &o.session, o.exactCnt, horizon, dist);
+		if (rest < 0) {
+			fprintf(stderr, _("Unable to compute the distribution.\n"));
+			free(dist);
+			return -1;
+		}
+		fprintf(stderr, _(", exact distribution for target 5★ #%u"), o.exactCnt);
+		fprintf(stderr, "\n\n");
+		cdf = 0;
+		mean = 0;
+		for (i = 1; i <= horizon; i++) {
+			cdf += dist[i];
+			mean += dist[i] * i;
+			if (dist[i] < 1e-15) continue;
+			printf(_("Wish %u: %.10f%% (cumulative %.10f%%)\n"), i, dist[i] * 100, cdf * 100);
+		}
+		printf(_("\nMean: %.4f wishes\n"), mean / (1.0 - rest));
+		if (rest >= 1e-15) {
+			printf(_("Chance of needing more than %u wishes: %.10f%%\n"), horizon, rest * 100);
+		}
+		cdf = 0;
+		for (i = 1; i <= o.pulls && i <= horizon; i++) {
+			cdf += dist[i];
+		}
+		printf(_("Chance within %u wishes: %.10f%%\n"), o.pulls, cdf * 100);
+		free(dist);
+		return 0;
 	}
-	if (!(banner == NOVICE || banner == CHRONICLED) && v[2]) {
-		fprintf(stderr, _(" (v%d.%d standard pool)"), v[3] >> 4, v[3] & 0xf);
+	if (o.trials) {
+		if (o.threads <= 0) {
+			o.threads = sysconf(_SC_NPROCESSORS_ONLN);
+			if (o.threads <= 0) o.threads = 1;
+		}
+		fprintf(stderr, _(", %llu times using %ld threads"), o.trials, o.threads);
+		if (o.firstTrial) {
+			fprintf(stderr, _(" (trials %llu to %llu)"), o.firstTrial, o.firstTrial + o.trials - 1);
+		}
+		fprintf(stderr, "\n\n");
+		if (o.profileHw) hwprofStart();
+		if (runTrials(&o.state, &o.cfg, &o.session, o.pulls, o.firstTrial, o.trials, o.threads, &hist) < 0) {
+			fprintf(stderr, _("Unable to run the trials.\n"));
+			return -1;
+		}
+		if (o.profileHw) hwprofStop(hist.trials * o.pulls);
+		printf(_("Results after %llu trials of %u wishes:\n"), hist.trials, o.pulls);
+		printHist(_("Pulls until the first 5★:"), hist.firstFive, o.pulls, hist.trials, 1);
+		printHist(_("Rate-up 5★ obtained:"), hist.rateUpFive, o.pulls, hist.trials, 0);
+		printHist(_("4★ obtained:"), hist.fourStars, o.pulls, hist.trials, 0);
+		freeTrialHist(&hist);
+		return 0;
 	}
 	fprintf(stderr, "\n\n");
-	for (i = 0; i < pulls; i++) {
-		if (banner == NOVICE && i == (7 - noviceCnt)) { // 8th wish is always Noelle on novice banner
-			rare = 4;
-			item = 1034;
-			won5050 = 0;
-			getRateUp[0] = 0;
-			pity[0] = 0;
-			pity[1]++;
-			pityS[0] = 0;
-			pityS[1] = 0;
+	if (o.profileHw) hwprofStart();
+	if (o.summary) {
+		n = o.cfg.do5050 > 0 && (o.banner == CHAR1 || o.banner == CHAR2 || o.banner == WPN || (o.banner == CHRONICLED && o.state.epitomizedPath && o.cfg.doEpitomized == 1));
+		if (summaryInit(&sum, n, (o.banner == WPN || (o.banner == CHRONICLED && o.state.epitomizedPath)) ? o.cfg.doEpitomized : 0) < 0) {
+			fprintf(stderr, _("Unable to allocate the summary.\n"));
+			return -1;
 		}
-		else {
-			if (forceSmooth & 1) {
-				pityS[0] = ~1;
-				pityS[2] = ~1;
-				pityS[1] = -1;
-				pityS[3] = -1;
+		for (i = 0; i < o.pulls; i++) {
+			pity5 = o.cfg.doPity[1] ? (o.state.pity[1] + 1) & 0xff : o.state.pity[1];
+			guaranteed = o.state.getRateUp[1];
+			fate = o.state.fatePoints;
+			item = doAWish(&o.state, &o.cfg, &o.session, i, &rare, &won5050);
+			if (item < 0) {
+				fprintf(stderr, _("Pull #%u failed (retcode = %d)\n"), i + 1, item);
+				break;
+			}
+			summaryAdd(&sum, item, rare, won5050, pity5, guaranteed, fate);
+		}
+		if (o.profileHw) hwprofStop(i);
+		summaryPrint(&sum, stdout);
+		summaryFree(&sum);
+		return 0;
+	}
+	if (o.format != FMT_TEXT) {
+		// No names, colors or translations here, just the raw results
+		outBegin(&out, stdout, o.format);
+		for (i = 0; i < o.pulls; i++) {
+			item = doAWish(&o.state, &o.cfg, &o.session, i, &rare, &won5050);
+			if (item < 0) {
+				fprintf(stderr, _("Pull #%u failed (retcode = %d)\n"), i + 1, item);
+				break;
 			}
-			if (forceSmooth & 2) {
-				pityS[1] = ~1;
-				pityS[3] = ~1;
-				pityS[0] = -1;
-				pityS[2] = -1;
+			rec.pull = i + 1;
+			rec.item = item;
+			rec.rare = rare;
+			rec.isRateUp = won5050;
+			rec.pity[0] = o.state.pity[0];
+			rec.pity[1] = o.state.pity[1];
+			rec.fatePoints = o.state.fatePoints;
+			if (outRecord(&out, &rec) < 0) break;
+		}
+		if (outFlush(&out) < 0 || fflush(stdout) != 0) {
+			fprintf(stderr, _("Unable to write the results: %s\n"), strerror(errno));
+			return -1;
+		}
+		if (o.profileHw) hwprofStop(i);
+		return 0;
+	}
+	if (o.tenPull) {
+		o.pulls = (o.pulls + 9) / 10 * 10;
+	}
+	for (i = 0; i < o.pulls; i++) {
+		if (o.tenPull) {
+			if (i % 10 == 0) {
+				doTenPull(&o.state, &o.cfg, &o.session, i, ten);
+				printf(_("%s10-pull #%u:\n"), i ? "\n" : "", i / 10 + 1);
 			}
-			// TODO Implement logic for character vs. item pool instead of checking the ID to determine that
-			item = doAPull(banner, v[0], b[0], &rare, &won5050);
+			item = ten[i % 10].item;
+			rare = ten[i % 10].rare;
+			won5050 = ten[i % 10].isRateUp;
 		}
+		else item = doAWish(&o.state, &o.cfg, &o.session, i, &rare, &won5050);
 		if (item < 0) {
 			fprintf(stderr, _("Pull #%u failed (retcode = %d)\n"), i + 1, item);
 			break;
@@ -932,51 +1426,42 @@ int main(int argc, char** argv) {
 			color = 31;
 		}
 		// Make the check simple by assuming all IDs between 1000 and 6000 are characters.
-		if (item < 6000 && item >= 1000) {
-			isChar = 1;
-			if (getItem(item) != NULL) {
-				snprintf(buf, 1024, _("\e[%u%sm%s\e[39;0m (id %u)"), color, shouldBold(rare, banner, won5050) ? ";1" : ";22", getItem(item), item);
-			}
-			else {
-				snprintf(buf, 1024, _("with id \e[%u%sm%u\e[39;0m"), color, shouldBold(rare, banner, won5050) ? ";1" : ";22", item);
-			}
+		isChar = item < 6000 && item >= 1000;
+		name = PROF(PHASE_LOOKUP, getItem(item));
+		if (name != NULL) {
+			PROF(PHASE_RENDER, snprintf(buf, 1024, _("\e[%u%sm%s\e[39;0m (id %u)"), color, shouldBold(rare, o.banner, won5050) ? ";1" : ";22", name, item));
 		}
 		else {
-			isChar = 0;
-			if (getItem(item) != NULL) {
-				snprintf(buf, 1024, _("\e[%u%sm%s\e[39;0m (id %u)"), color, shouldBold(rare, banner, won5050) ? ";1" : ";22", getItem(item), item);
-			}
-			else {
-				snprintf(buf, 1024, _("with id \e[%u%sm%u\e[39;0m"), color, shouldBold(rare, banner, won5050) ? ";1" : ";22", item);
-			}
+			PROF(PHASE_RENDER, snprintf(buf, 1024, _("with id \e[%u%sm%u\e[39;0m"), color, shouldBold(rare, o.banner, won5050) ? ";1" : ";22", item));
 		}
-		printf(_("Pull %u: %u★ %s %s\n"), i + 1, rare, isChar ? _("Character") : _("Weapon"), buf);
+		PROF(PHASE_WRITE, printf(_("Pull %u: %u★ %s %s\n"), i + 1, rare, isChar ? _("Character") : _("Weapon"), buf));
 	}
+	if (o.profileHw) hwprofStop(i);
 	printf(_("\nResults after last pull:\n"));
-	if (doPity[0]) {
-		printf(_("\n4★ pity: %u"), pity[0]);
+	if (o.cfg.doPity[0]) {
+		printf(_("\n4★ pity: %u"), o.state.pity[0]);
 	}
-	if (doPity[1]) {
-		printf(_("\n5★ pity: %u\n"), pity[1]);
+	if (o.cfg.doPity[1]) {
+		printf(_("\n5★ pity: %u\n"), o.state.pity[1]);
 	}
 	else printf("\n");
-	if (do5050 > 0 && (banner == CHAR1 || banner == CHAR2 || banner == WPN || (banner == CHRONICLED && epitomizedPath && doEpitomized == 1))) {
+	if (o.cfg.do5050 > 0 && (o.banner == CHAR1 || o.banner == CHAR2 || o.banner == WPN || (o.banner == CHRONICLED && o.state.epitomizedPath && o.cfg.doEpitomized == 1))) {
 		printf("\n");
-		if (banner != CHRONICLED) {
-			printf(_("4★ guaranteed: %u\n"), getRateUp[0] ? 1 : 0);
+		if (o.banner != CHRONICLED) {
+			printf(_("4★ guaranteed: %u\n"), o.state.getRateUp[0] ? 1 : 0);
 		}
-		printf(_("5★ guaranteed: %u\n"), getRateUp[1] ? 1 : 0);
+		printf(_("5★ guaranteed: %u\n"), o.state.getRateUp[1] ? 1 : 0);
 	}
-	if (doEpitomized > 1) {
-		printf(_("Fate Points: %u\n"), fatePoints);
+	if (o.cfg.doEpitomized > 1) {
+		printf(_("Fate Points: %u\n"), o.state.fatePoints);
 	}
-	if (do5050 >= 0 && doSmooth[0] && banner != NOVICE) {
-		printf(_("\n4★ stable val (characters): %u\n"), pityS[0]);
-		printf(_("4★ stable val (weapons): %u"), pityS[1]);
+	if (o.cfg.do5050 >= 0 && o.cfg.doSmooth[0] && o.banner != NOVICE) {
+		printf(_("\n4★ stable val (characters): %u\n"), o.state.pityS[0]);
+		printf(_("4★ stable val (weapons): %u"), o.state.pityS[1]);
 	}
-	if (do5050 >= 0 && doSmooth[1] && (banner == STD_CHR || banner == STD_WPN || banner == STD_ONLY_CHR || (banner == CHRONICLED && !epitomizedPath))) {
-		printf(_("\n5★ stable val (characters): %u\n"), pityS[2]);
-		printf(_("5★ stable val (weapons): %u\n"), pityS[3]);
+	if (o.cfg.do5050 >= 0 && o.cfg.doSmooth[1] && (o.banner == STD_CHR || o.banner == STD_WPN || o.banner == STD_ONLY_CHR || (o.banner == CHRONICLED && !o.state.epitomizedPath))) {
+		printf(_("\n5★ stable val (characters): %u\n"), o.state.pityS[2]);
+		printf(_("5★ stable val (weapons): %u\n"), o.state.pityS[3]);
 	}
 	else printf("\n");
 	return 0;
@@ -0,0 +1,396 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+// Differential test of the pull kernels against the frozen reference in refpull.c
+// Each case picks a banner, a banner version, a configuration and a starting state for every lane at random, records what the
+// reference does with the words of each lane's generator, then runs every kernel from the same states and compares each pull:
+// the drop, the counters, and where the generator is left. The first pull where a kernel diverges is reported with the case that
+// produced it, and that kernel isn't checked any further. The cases come from YAGIWS_DIFF_SEED, so a failure can be replayed.
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "batch.h"
+#include "gacha.h"
+#include "refpull.h"
+#include "util.h"
+
+#define DIFF_CASES 1000
+#define DIFF_SEED 0x52454650
+#define DIFF_LANES 16
+// A multiple of 10, for doTenPull
+#define DIFF_PULLS 100
+#define DIFF_CHUNK_MAX 25
+
+enum {
+	K_GLOBAL = 0,
+	K_R,
+	K_P,
+	K_GENERIC,
+	K_TEN,
+	K_PACKED,
+	K_BATCH,
+	K_BATCH_SCALAR,
+	K_CNT
+};
+static const char* const kernelNames[K_CNT] = {
+	[K_GLOBAL] = "doAPull",
+	[K_R] = "doAPull_r",
+	[K_P] = "doAPull_p",
+	[K_GENERIC] = "doAPull_p (generic kernel)",
+	[K_TEN] = "doTenPull",
+	[K_PACKED] = "doWishesPacked",
+	[K_BATCH] = "batchWish",
+	[K_BATCH_SCALAR] = "batchWish (no SIMD)",
+};
+
+// What to compare after a pull
+#define CMP_DROP 1
+// pity and fatePoints, as kept in a PullResult_t
+#define CMP_COUNTERS 2
+// The rest of the state, and the generator
+#define CMP_STATE 4
+#define CMP_ALL (CMP_DROP | CMP_COUNTERS | CMP_STATE)
+
+// What the reference did on one pull, and where it left the tape
+typedef struct {
+	unsigned short item;
+	unsigned char rare;
+	unsigned char isRateUp;
+	RefState_t st;
+	size_t pos;
+	unsigned long long bits;
+	unsigned int nbits;
+} Expect_t;
+
+typedef struct {
+	unsigned int no;
+	unsigned int banner;
+	unsigned int version;
+	unsigned int rngType;
+	unsigned int stdPoolIndex;
+	unsigned int bannerIndex;
+	GachaConfig_t cfg;
+	Session_t ses;
+	// The same banner left on the generic kernel
+	PreparedBanner_t generic;
+	RefBanner_t ref;
+	unsigned long long seed[DIFF_LANES];
+	GachaState_t init[DIFF_LANES];
+	Tape_t tape[DIFF_LANES];
+	Expect_t exp[DIFF_LANES][DIFF_PULLS];
+} Case_t;
+static Case_t c;
+
+static unsigned int diverged[K_CNT];
+static unsigned long long checked[K_CNT];
+
+// The flag sets that selectKernel has specialized kernels for, which random configurations would seldom hit
+static const GachaConfig_t presets[] = {
+	{.doSmooth = {1, 1}, .doPity = {1, 1}, .do5050 = 1},
+	{.doSmooth = {1, 1}, .doPity = {0, 0}, .do5050 = 1},
+	{.doSmooth = {0, 0}, .doPity = {1, 1}, .do5050 = 1},
+	{.doSmooth = {1, 1}, .doPity = {1, 1}, .do5050 = -1},
+	{.doSmooth = {-1, -1}, .doPity = {1, 1}, .do5050 = 1},
+};
+
+// Banner versions as 0xMmp, by the last minor version of each major one
+static const unsigned int lastMinor[5] = {6, 8, 8, 8, 4};
+
+static unsigned int pick(Rng_t* gen, unsigned int n) {
+	return rndBounded_r(gen, n);
+}
+
+static int makeCase(Rng_t* gen) {
+	const GachaConfig_t* f;
+	GachaState_t* st;
+	unsigned int i, major, isWpnBanner;
+	int idx;
+	c.banner = pick(gen, WISH_CNT);
+	if (c.banner == CHRONICLED) {
+		c.version = pick(gen, 2) ? 0x441 : 0x532;
+	}
+	else {
+		major = 1 + pick(gen, 5);
+		c.version = major << 8 | pick(gen, lastMinor[major - 1] + 1) << 4 | (1 + pick(gen, 2));
+	}
+	idx = getBannerIndex(c.banner, c.version);
+	if (idx < 0 || idx >= IDX_MAX * 2) return -1;
+	if (c.banner == CHAR2 && FiveStarChrUp[idx][1] == 0xffff) return -1;
+	c.bannerIndex = idx;
+	idx = getPoolIndex(c.banner, c.version >> 4);
+	if (idx < 0 || idx >= IDX_MAX) return -1;
+	c.stdPoolIndex = idx;
+	if (prepareBanner(&c.ses.pb, c.banner, c.stdPoolIndex, c.bannerIndex) < 0) return -1;
+	if (refPrepare(&c.ref, c.banner, c.stdPoolIndex, c.bannerIndex) < 0) return -1;
+	c.generic = c.ses.pb;
+	if (pick(gen, 2)) {
+		f = &presets[pick(gen, sizeof(presets) / sizeof(presets[0]))];
+		c.cfg = *f;
+	}
+	else {
+		for (i = 0; i < 2; i++) {
+			c.cfg.doSmooth[i] = pick(gen, 3) - 1;
+			c.cfg.doPity[i] = pick(gen, 2);
+		}
+		c.cfg.do5050 = pick(gen, 3) - 1;
+	}
+	c.cfg.doEpitomized = pick(gen, 4) - 1;
+	c.cfg.doRadiance = pick(gen, 3) - 1;
+	// The kernels resolve the defaults left on auto themselves, so half of the cases leave them that way
+	if (pick(gen, 2)) resolveGachaConfig(&c.cfg, c.banner, c.version);
+	selectKernel(&c.ses.pb, &c.cfg);
+	// Only the reference has the fixed Beginners' Wish drop left out, so it's left out of doAWish too
+	c.ses.noviceCnt = 8;
+	c.ses.forceSmooth = 0;
+	c.rngType = pick(gen, 2) ? RNG_XOSHIRO : RNG_PHILOX;
+	isWpnBanner = c.banner == WPN || c.banner == STD_WPN;
+	for (i = 0; i < DIFF_LANES; i++) {
+		st = &c.init[i];
+		initGachaState(st);
+		c.seed[i] = rndWord_r(gen);
+		rngSeed(&st->rng, c.rngType, c.seed[i]);
+		st->pity[0] = pick(gen, 10);
+		st->pity[1] = pick(gen, isWpnBanner ? 80 : 90);
+		// Stable pity either near its usual range or past the point where it rises
+		st->pityS[0] = pick(gen, 2) ? pick(gen, 20) : pick(gen, 160);
+		st->pityS[1] = pick(gen, 2) ? pick(gen, 20) : pick(gen, 160);
+		st->pityS[2] = pick(gen, 2) ? pick(gen, 20) : pick(gen, 160);
+		st->pityS[3] = pick(gen, 2) ? pick(gen, 20) : pick(gen, 160);
+		st->getRateUp[0] = pick(gen, 2);
+		st->getRateUp[1] = pick(gen, 2);
+		st->fatePoints = pick(gen, 3);
+		if (c.banner == WPN) {
+			idx = pick(gen, 3);
+			st->epitomizedPath = idx ? c.ses.pb.fiveUp[idx - 1] : 0;
+		}
+		else if (c.banner == CHRONICLED && pick(gen, 2)) {
+			st->epitomizedPath = c.ses.pb.five[pick(gen, c.ses.pb.fiveChrCnt + c.ses.pb.fiveWpnCnt)];
+		}
+	}
+	return 0;
+}
+
+static int record(unsigned int lane) {
+	const GachaState_t* init = &c.init[lane];
+	Tape_t* t = &c.tape[lane];
+	Expect_t* e;
+	RefState_t st;
+	unsigned int i, rare, isRateUp;
+	memcpy(st.pity, init->pity, sizeof(st.pity));
+	memcpy(st.pityS, init->pityS, sizeof(st.pityS));
+	memcpy(st.getRateUp, init->getRateUp, sizeof(st.getRateUp));
+	st.fatePoints = init->fatePoints;
+	st.epitomizedPath = init->epitomizedPath;
+	if (tapeInit(t, &init->rng) < 0) return -1;
+	for (i = 0; i < DIFF_PULLS; i++) {
+		e = &c.exp[lane][i];
+		e->item = refPull(&st, &c.cfg, &c.ref, t, &rare, &isRateUp);
+		e->rare = rare;
+		e->isRateUp = isRateUp;
+		e->st = st;
+		e->pos = t->pos;
+		e->bits = t->bits;
+		e->nbits = t->nbits;
+	}
+	return tapeFailed(t) ? -1 : 0;
+}
+
+// Where a kernel is being compared, for the report
+typedef struct {
+	unsigned int k;
+	unsigned int lane;
+	unsigned int pull;
+} At_t;
+
+static int same(const At_t* at, const char* what, unsigned long long want, unsigned long long got) {
+	if (want == got) return 1;
+	printf("FAIL: %s: case %u, lane %u, pull %u: %s is %llu, expected %llu\n", kernelNames[at->k], c.no, at->lane, at->pull, what, got, want);
+	printf("      %s %x.%x phase %u, %s seed %#llx, doSmooth %d/%d, doPity %d/%d, do5050 %d, doEpitomized %d, doRadiance %d\n", banners[c.banner][0], c.version >> 8, c.version >> 4 & 0xf, c.version & 0xf, rngNames[c.rngType][0], c.seed[at->lane], c.cfg.doSmooth[0], c.cfg.doSmooth[1], c.cfg.doPity[0], c.cfg.doPity[1], c.cfg.do5050, c.cfg.doEpitomized, c.cfg.doRadiance);
+	diverged[at->k] = 1;
+	return 0;
+}
+
+// Compares a pull with the reference, returning 0 if it diverged
+static int compare(unsigned int k, unsigned int lane, unsigned int pull, unsigned int what, unsigned int item, unsigned int rare, unsigned int isRateUp, const GachaState_t* st) {
+	static const char* const pitySNames[4] = {"pityS[0]", "pityS[1]", "pityS[2]", "pityS[3]"};
+	const Expect_t* e = &c.exp[lane][pull];
+	At_t at = {k, lane, pull};
+	Rng_t r;
+	unsigned int i;
+	int ok = 1;
+	if (what & CMP_DROP) {
+		ok = ok && same(&at, "item", e->item, item);
+		ok = ok && same(&at, "rarity", e->rare, rare);
+		ok = ok && same(&at, "isRateUp", e->isRateUp, isRateUp);
+	}
+	if (what & CMP_COUNTERS) {
+		ok = ok && same(&at, "pity[0]", e->st.pity[0], st->pity[0]);
+		ok = ok && same(&at, "pity[1]", e->st.pity[1], st->pity[1]);
+		ok = ok && same(&at, "fatePoints", e->st.fatePoints, st->fatePoints);
+	}
+	if (what & CMP_STATE) {
+		for (i = 0; i < 4; i++) {
+			ok = ok && same(&at, pitySNames[i], e->st.pityS[i], st->pityS[i]);
+		}
+		ok = ok && same(&at, "getRateUp[0]", e->st.getRateUp[0], st->getRateUp[0]);
+		ok = ok && same(&at, "getRateUp[1]", e->st.getRateUp[1], st->getRateUp[1]);
+		ok = ok && same(&at, "epitomizedPath", e->st.epitomizedPath, st->epitomizedPath);
+		// The next word out of the generator, reserved or not, has to be the next one on the tape
+		r = st->rng;
+		ok = ok && same(&at, "next random word", tapeWord(&c.tape[lane], e->pos), rndWord_r(&r));
+		ok = ok && same(&at, "reservoir bits", e->bits, st->rng.bits);
+		ok = ok && same(&at, "reservoir size", e->nbits, st->rng.nbits);
+	}
+	return ok;
+}
+
+static void loadGlobals(const GachaState_t* st) {
+	gachaState = *st;
+	memcpy(doSmooth, c.cfg.doSmooth, sizeof(doSmooth));
+	memcpy(doPity, c.cfg.doPity, sizeof(doPity));
+	do5050 = c.cfg.do5050;
+	doEpitomized = c.cfg.doEpitomized;
+	doRadiance = c.cfg.doRadiance;
+}
+
+static void storeGlobals(GachaState_t* st) {
+	*st = gachaState;
+}
+
+// Kernels that make one pull at a time
+static void runSingle(unsigned int k, unsigned int lane) {
+	GachaState_t st = c.init[lane];
+	unsigned int i, item, rare, isRateUp;
+	if (k == K_GLOBAL) loadGlobals(&st);
+	for (i = 0; i < DIFF_PULLS; i++) {
+		switch (k) {
+		case K_GLOBAL:
+		default:
+			item = doAPull(c.banner, c.stdPoolIndex, c.bannerIndex, &rare, &isRateUp);
+			storeGlobals(&st);
+			break;
+		case K_R:
+			item = doAPull_r(&st, &c.cfg, c.banner, c.stdPoolIndex, c.bannerIndex, &rare, &isRateUp);
+			break;
+		case K_P:
+			item = doAPull_p(&st, &c.cfg, &c.ses.pb, &rare, &isRateUp);
+			break;
+		case K_GENERIC:
+			item = doAPull_p(&st, &c.cfg, &c.generic, &rare, &isRateUp);
+			break;
+		}
+		if (!compare(k, lane, i, CMP_ALL, item, rare, isRateUp, &st)) return;
+		checked[k]++;
+	}
+}
+
+static void runTen(unsigned int lane) {
+	GachaState_t st = c.init[lane], cnt;
+	PullResult_t res[10];
+	unsigned int i, j;
+	for (i = 0; i < DIFF_PULLS; i += 10) {
+		doTenPull(&st, &c.cfg, &c.ses, i, res);
+		for (j = 0; j < 10; j++) {
+			cnt.pity[0] = res[j].pity[0];
+			cnt.pity[1] = res[j].pity[1];
+			cnt.fatePoints = res[j].fatePoints;
+			if (!compare(K_TEN, lane, i + j, CMP_DROP | CMP_COUNTERS, res[j].item, res[j].rare, res[j].isRateUp, &cnt)) return;
+			checked[K_TEN]++;
+		}
+		if (!compare(K_TEN, lane, i + 9, CMP_STATE, 0, 0, 0, &st)) return;
+	}
+}
+
+// In chunks of random sizes, which doesn't always line up with the reserves made every 10 wishes
+static void runPacked(unsigned int lane, Rng_t* gen) {
+	GachaState_t st = c.init[lane];
+	unsigned int res[DIFF_CHUNK_MAX];
+	unsigned int i, j, n;
+	for (i = 0; i < DIFF_PULLS; i += n) {
+		n = 1 + pick(gen, DIFF_CHUNK_MAX);
+		if (n > DIFF_PULLS - i) n = DIFF_PULLS - i;
+		doWishesPacked(&st, &c.cfg, &c.ses, i, n, res);
+		for (j = 0; j < n; j++) {
+			if (!compare(K_PACKED, lane, i + j, CMP_DROP, res[j] & 0xffff, res[j] >> 16 & 7, res[j] >> 19 & 3, &st)) return;
+			checked[K_PACKED]++;
+		}
+		if (!compare(K_PACKED, lane, i + n - 1, CMP_COUNTERS | CMP_STATE, 0, 0, 0, &st)) return;
+	}
+}
+
+// Every lane at once
+static int runBatch(unsigned int k, unsigned int simd) {
+	Batch_t b;
+	GachaState_t st;
+	unsigned short item[DIFF_LANES];
+	unsigned char rare[DIFF_LANES], isRateUp[DIFF_LANES];
+	unsigned int i, j;
+	if (batchInit(&b, DIFF_LANES) < 0) return -1;
+	if (!simd) b.simd = 0;
+	for (j = 0; j < DIFF_LANES; j++) {
+		batchLoad(&b, j, &c.init[j]);
+	}
+	for (i = 0; i < DIFF_PULLS; i++) {
+		batchWish(&b, &c.cfg, &c.ses, i, item, rare, isRateUp);
+		for (j = 0; j < DIFF_LANES; j++) {
+			batchStore(&b, j, &st);
+			if (!compare(k, j, i, CMP_ALL, item[j], rare[j], isRateUp[j], &st)) {
+				batchFree(&b);
+				return 0;
+			}
+			checked[k]++;
+		}
+	}
+	batchFree(&b);
+	return 0;
+}
+
+int main(void) {
+	unsigned long long seed = DIFF_SEED;
+	unsigned int cases = DIFF_CASES, failures = 0, k, lane;
+	const char* env;
+	Rng_t gen, chunks;
+	env = getenv("YAGIWS_DIFF_CASES");
+	if (env != NULL && *env != '\0') cases = strtoul(env, NULL, 0);
+	env = getenv("YAGIWS_DIFF_SEED");
+	if (env != NULL && *env != '\0') seed = strtoull(env, NULL, 0);
+	rngSeed(&gen, RNG_XOSHIRO, seed);
+	for (c.no = 0; c.no < cases; c.no++) {
+		while (makeCase(&gen) < 0);
+		// Drawn apart from the cases, so that they stay the same whichever kernels are still being checked
+		rngSeed(&chunks, RNG_XOSHIRO, rndWord_r(&gen));
+		for (lane = 0; lane < DIFF_LANES; lane++) {
+			if (record(lane) < 0) {
+				printf("ERROR: out of memory\n");
+				return 99;
+			}
+		}
+		for (k = K_GLOBAL; k <= K_GENERIC; k++) {
+			for (lane = 0; lane < DIFF_LANES && !diverged[k]; lane++) {
+				runSingle(k, lane);
+			}
+		}
+		for (lane = 0; lane < DIFF_LANES && !diverged[K_TEN]; lane++) {
+			runTen(lane);
+		}
+		for (lane = 0; lane < DIFF_LANES && !diverged[K_PACKED]; lane++) {
+			runPacked(lane, &chunks);
+		}
+		if ((!diverged[K_BATCH] && runBatch(K_BATCH, 1) < 0) || (!diverged[K_BATCH_SCALAR] && runBatch(K_BATCH_SCALAR, 0) < 0)) {
+			printf("ERROR: out of memory\n");
+			return 99;
+		}
+		for (lane = 0; lane < DIFF_LANES; lane++) {
+			tapeFree(&c.tape[lane]);
+		}
+	}
+	for (k = 0; k < K_CNT; k++) {
+		if (diverged[k]) failures++;
+		else printf("PASS: %s: %llu pulls match the reference\n", kernelNames[k], checked[k]);
+	}
+	printf("%u of %u kernels diverged in %u cases from seed %#llx\n", failures, K_CNT, cases, seed);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,420 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+#include "refpull.h"
+
+// Tape
+
+int tapeInit(Tape_t* t, const Rng_t* src) {
+	memset(t, 0, sizeof(Tape_t));
+	t->src = *src;
+	t->bits = src->bits;
+	t->nbits = src->nbits;
+	t->cap = 1024;
+	t->w = malloc(t->cap * sizeof(unsigned long long));
+	return t->w == NULL ? -1 : 0;
+}
+
+void tapeFree(Tape_t* t) {
+	free(t->w);
+	t->w = NULL;
+}
+
+unsigned long long tapeWord(Tape_t* t, size_t pos) {
+	unsigned long long* w;
+	while (pos >= t->len) {
+		if (t->len == t->cap) {
+			w = realloc(t->w, t->cap * 2 * sizeof(unsigned long long));
+			if (w == NULL) {
+				t->failed = 1;
+				return 0;
+			}
+			t->w = w;
+			t->cap *= 2;
+		}
+		t->w[t->len++] = rndWord_r(&t->src);
+	}
+	return t->w[pos];
+}
+
+int tapeFailed(const Tape_t* t) {
+	return t->failed;
+}
+
+static unsigned long long next(Tape_t* t) {
+	return tapeWord(t, t->pos++);
+}
+
+// Top 63 bits of a word, in [0, 2^63)
+static unsigned long long fixed(Tape_t* t) {
+	return next(t) >> 1;
+}
+
+// Uniform integer in [0, n), from the top 32 bits of a word, rejecting draws that would bias it
+static unsigned int bounded(Tape_t* t, unsigned int n) {
+	unsigned long long m = (next(t) >> 32) * n;
+	unsigned int limit = -n % n;
+	while ((unsigned int) m < limit) {
+		m = (next(t) >> 32) * n;
+	}
+	return m >> 32;
+}
+
+// The lowest k bits of the reservoir, which is refilled with a whole word when it runs short
+static unsigned int bits(Tape_t* t, unsigned int k) {
+	unsigned int ret;
+	if (t->nbits < k) {
+		t->bits = next(t);
+		t->nbits = 64;
+	}
+	ret = t->bits & ((1ull << k) - 1);
+	t->bits >>= k;
+	t->nbits -= k;
+	return ret;
+}
+
+// Chances
+
+// Chance thresholds are floor(w / 10000 * 2^63) for a weight w in ten-thousandths, which the rolls above are compared against
+static unsigned long long thr(unsigned int w) {
+	if (w >= 10000) return 1ull << 63;
+	return (unsigned long long) (((unsigned __int128) w << 63) / 10000);
+}
+
+static unsigned int weight5(unsigned int banner, unsigned int p) {
+	if (banner == WPN || banner == STD_WPN) {
+		if (p <= 62) return 70;
+		if (p <= 73) return 70 + 700 * (p - 62);
+		return 7770 + 350 * (p - 73);
+	}
+	return p <= 73 ? 60 : 60 + 600 * (p - 73);
+}
+
+static unsigned int weight4(unsigned int banner, unsigned int p) {
+	if (banner == WPN || banner == STD_WPN) {
+		if (p <= 7) return 600;
+		return 6600 + 3000 * (p - 8);
+	}
+	return p <= 8 ? 510 : 510 + 5100 * (p - 8);
+}
+
+// Chance of the type not picked last, by the pulls since it was, on a 50/50 when stable pity is off
+static unsigned long long stable(unsigned int banner, unsigned int rare, int doSmooth, unsigned int p) {
+	if (!doSmooth) return thr(5000);
+	if (rare == 5) return thr(p <= 146 ? 30 : 30 + 300 * (p - 146));
+	if (banner == WPN || banner == STD_WPN) return thr(p <= 14 ? 300 : 300 + 3000 * (p - 14));
+	return thr(p <= 17 ? 255 : 255 + 2550 * (p - 17));
+}
+
+// Banner
+
+int refPrepare(RefBanner_t* b, unsigned int banner, unsigned int stdPoolIndex, unsigned int bannerIndex) {
+	const ChroniclePool_t* cp = NULL;
+	unsigned int five, four;
+	if (banner >= WISH_CNT || stdPoolIndex >= IDX_MAX || bannerIndex >= IDX_MAX * 2) return -1;
+	five = FiveStarMaxIndex[stdPoolIndex];
+	four = FourStarMaxIndex[stdPoolIndex];
+	if (banner == CHRONICLED) {
+		cp = getChroniclePool(bannerIndex);
+		if (cp == NULL) return -1;
+	}
+	memset(b, 0, sizeof(RefBanner_t));
+	b->banner = banner;
+	memcpy(b->three, ThreeStar, sizeof(ThreeStar));
+	b->threeCnt = sizeof(ThreeStar) / sizeof(ThreeStar[0]);
+	switch (banner) {
+	case CHAR1:
+	case CHAR2:
+		b->fiveUp[0] = FiveStarChrUp[bannerIndex][banner - CHAR1];
+		memcpy(b->five, FiveStarChr, five * sizeof(unsigned short));
+		b->fiveChrCnt = five;
+		memcpy(b->fourUp, FourStarChrUp[bannerIndex], 3 * sizeof(unsigned short));
+		memcpy(b->four, FourStarChr + 3, four * sizeof(unsigned short));
+		memcpy(b->four + four, FourStarWpn, sizeof(FourStarWpn));
+		b->fourChrCnt = four;
+		b->fourWpnCnt = sizeof(FourStarWpn) / sizeof(FourStarWpn[0]);
+		break;
+	case WPN:
+		memcpy(b->fiveUp, FiveStarWpnUp[bannerIndex], 2 * sizeof(unsigned short));
+		memcpy(b->five, FiveStarWpn, sizeof(FiveStarWpn));
+		b->fiveWpnCnt = sizeof(FiveStarWpn) / sizeof(FiveStarWpn[0]);
+		memcpy(b->fourUp, FourStarWpnUp[bannerIndex], 5 * sizeof(unsigned short));
+		memcpy(b->four, FourStarChr + 3, four * sizeof(unsigned short));
+		memcpy(b->four + four, FourStarWpn, sizeof(FourStarWpn));
+		b->fourChrCnt = four;
+		b->fourWpnCnt = sizeof(FourStarWpn) / sizeof(FourStarWpn[0]);
+		break;
+	case CHRONICLED:
+		if (cp->FiveStarCharCount + cp->FiveStarWeaponCount > POOL5_MAX || cp->FourStarCharCount + cp->FourStarWeaponCount > POOL4_MAX) return -1;
+		memcpy(b->five, cp->FiveStarPool, (cp->FiveStarCharCount + cp->FiveStarWeaponCount) * sizeof(unsigned short));
+		b->fiveChrCnt = cp->FiveStarCharCount;
+		b->fiveWpnCnt = cp->FiveStarWeaponCount;
+		memcpy(b->four, cp->FourStarPool, (cp->FourStarCharCount + cp->FourStarWeaponCount) * sizeof(unsigned short));
+		b->fourChrCnt = cp->FourStarCharCount;
+		b->fourWpnCnt = cp->FourStarWeaponCount;
+		break;
+	case NOVICE:
+		memcpy(b->five, FiveStarChr, five * sizeof(unsigned short));
+		b->fiveChrCnt = five;
+		memcpy(b->four, FourStarChr + 3, four * sizeof(unsigned short));
+		b->fourChrCnt = four;
+		break;
+	case STD_WPN:
+		memcpy(b->five, FiveStarWpn, sizeof(FiveStarWpn));
+		b->fiveWpnCnt = sizeof(FiveStarWpn) / sizeof(FiveStarWpn[0]);
+		memcpy(b->four, FourStarChr, (four + 3) * sizeof(unsigned short));
+		memcpy(b->four + four + 3, FourStarWpn, sizeof(FourStarWpn));
+		b->fourChrCnt = four + 3;
+		b->fourWpnCnt = sizeof(FourStarWpn) / sizeof(FourStarWpn[0]);
+		break;
+	case STD_ONLY_CHR:
+		memcpy(b->five, FiveStarChr, five * sizeof(unsigned short));
+		b->fiveChrCnt = five;
+		memcpy(b->four, FourStarChr, (four + 3) * sizeof(unsigned short));
+		memcpy(b->four + four + 3, FourStarWpn, sizeof(FourStarWpn));
+		b->fourChrCnt = four + 3;
+		b->fourWpnCnt = sizeof(FourStarWpn) / sizeof(FourStarWpn[0]);
+		break;
+	case STD_CHR:
+		memcpy(b->five, FiveStarChr, five * sizeof(unsigned short));
+		memcpy(b->five + five, FiveStarWpn, sizeof(FiveStarWpn));
+		b->fiveChrCnt = five;
+		b->fiveWpnCnt = sizeof(FiveStarWpn) / sizeof(FiveStarWpn[0]);
+		memcpy(b->four, FourStarChr, (four + 3) * sizeof(unsigned short));
+		memcpy(b->four + four + 3, FourStarWpn, sizeof(FourStarWpn));
+		b->fourChrCnt = four + 3;
+		b->fourWpnCnt = sizeof(FourStarWpn) / sizeof(FourStarWpn[0]);
+		break;
+	}
+	return 0;
+}
+
+// Pull
+
+static int isGuaranteed(const GachaConfig_t* cfg, const RefState_t* st, unsigned int i) {
+	if (cfg->do5050 < 0) return 1;
+	if (cfg->do5050 == 0) return 0;
+	return st->getRateUp[i];
+}
+
+// Picks a character or a weapon from [chr, chr + wpn) with stable pity, where s points at the character and weapon counters.
+// Returns the range to pick from in *min and *max.
+static void pickStable(unsigned int banner, unsigned int rare, int doSmooth, unsigned char* s, unsigned long long rndFx, unsigned int chr, unsigned int* min, unsigned int* max) {
+	if (s[0] <= s[1]) {
+		if (rndFx < stable(banner, rare, doSmooth, s[1])) {
+			s[1] = 0;
+			*min = chr;
+		}
+		else {
+			s[0] = 0;
+			*max = chr;
+		}
+	}
+	else {
+		if (rndFx < stable(banner, rare, doSmooth, s[0])) {
+			s[0] = 0;
+			*max = chr;
+		}
+		else {
+			s[1] = 0;
+			*min = chr;
+		}
+	}
+}
+
+static unsigned int pull5(RefState_t* st, const GachaConfig_t* cfg, const RefBanner_t* b, Tape_t* t, int epitomized, unsigned int* isRateUp) {
+	unsigned long long rndFx;
+	unsigned int rnd, min = 0, max = b->fiveChrCnt + b->fiveWpnCnt;
+	st->pity[1] = 0;
+	switch (b->banner) {
+	case CHAR1:
+	case CHAR2:
+		st->pityS[2] = 0;
+		st->pityS[3] = 0;
+		rnd = isGuaranteed(cfg, st, 1) ? 0 : bits(t, 1);
+		if (rnd == 0) {
+			*isRateUp = 1;
+			st->getRateUp[1] = 0;
+			st->fatePoints = 0;
+			return b->fiveUp[0];
+		}
+		if (cfg->doRadiance > 0) {
+			do {
+				rnd = bits(t, 4);
+			} while (rnd >= 10);
+			if (rnd == 0) {
+				*isRateUp = 2;
+				st->getRateUp[1] = 0;
+				st->fatePoints = 0;
+				return b->fiveUp[0];
+			}
+		}
+		*isRateUp = 0;
+		st->getRateUp[1] = 1;
+		st->fatePoints++;
+		return b->five[bounded(t, b->fiveChrCnt)];
+	case WPN:
+		st->pityS[2] = 0;
+		st->pityS[3] = 0;
+		rnd = st->fatePoints < epitomized && !isGuaranteed(cfg, st, 1) ? bits(t, 2) : 0;
+		if (rnd == 3) {
+			*isRateUp = 0;
+			st->getRateUp[1] = 1;
+			st->fatePoints++;
+			return b->five[b->fiveChrCnt + bounded(t, b->fiveWpnCnt)];
+		}
+		*isRateUp = 1;
+		st->getRateUp[1] = 0;
+		if (st->fatePoints >= epitomized) {
+			st->fatePoints = 0;
+			return st->epitomizedPath;
+		}
+		rnd = bits(t, 1);
+		if (st->epitomizedPath) {
+			if (b->fiveUp[rnd] == st->epitomizedPath) st->fatePoints = 0;
+			else st->fatePoints++;
+		}
+		return b->fiveUp[rnd];
+	case CHRONICLED:
+		if (st->epitomizedPath && epitomized) {
+			st->pityS[2] = 0;
+			st->pityS[3] = 0;
+			if (st->epitomizedPath >= 10000) min = b->fiveChrCnt;
+			else max = b->fiveChrCnt;
+			rnd = st->fatePoints < epitomized && !isGuaranteed(cfg, st, 1) ? bits(t, 1) : 0;
+			if (rnd == 0) {
+				*isRateUp = 1;
+				st->getRateUp[1] = 0;
+				st->fatePoints = 0;
+				return st->epitomizedPath;
+			}
+			rnd = b->five[min + bounded(t, max - min)];
+			if (rnd == st->epitomizedPath) {
+				*isRateUp = 1;
+				st->getRateUp[1] = 0;
+				st->fatePoints = 0;
+			}
+			else {
+				*isRateUp = 0;
+				st->getRateUp[1] = 1;
+				st->fatePoints++;
+			}
+			return rnd;
+		}
+		// Without a Chronicled Path, it's the standard banner with every pull counted as rate-up
+		*isRateUp = 1;
+		st->getRateUp[1] = 0;
+		st->fatePoints = 0;
+		rndFx = fixed(t);
+		if (cfg->doSmooth[1] >= 0) pickStable(b->banner, 5, cfg->doSmooth[1], st->pityS + 2, rndFx, b->fiveChrCnt, &min, &max);
+		return b->five[min + bounded(t, max - min)];
+	case NOVICE:
+	case STD_ONLY_CHR:
+		*isRateUp = 0;
+		st->getRateUp[1] = 0;
+		st->fatePoints = 0;
+		st->pityS[2] = 0;
+		st->pityS[3] = 0;
+		return b->five[bounded(t, b->fiveChrCnt)];
+	case STD_WPN:
+		*isRateUp = 0;
+		st->getRateUp[1] = 0;
+		st->fatePoints = 0;
+		st->pityS[2] = 0;
+		st->pityS[3] = 0;
+		return b->five[b->fiveChrCnt + bounded(t, b->fiveWpnCnt)];
+	case STD_CHR:
+	default:
+		*isRateUp = 0;
+		st->getRateUp[1] = 0;
+		st->fatePoints = 0;
+		rndFx = fixed(t);
+		if (cfg->doSmooth[1] >= 0) pickStable(b->banner, 5, cfg->doSmooth[1], st->pityS + 2, rndFx, b->fiveChrCnt, &min, &max);
+		return b->five[min + bounded(t, max - min)];
+	}
+}
+
+static unsigned int pull4(RefState_t* st, const GachaConfig_t* cfg, const RefBanner_t* b, Tape_t* t, unsigned int* isRateUp) {
+	unsigned long long rndFx;
+	unsigned int rnd, min = 0, max = b->fourChrCnt + b->fourWpnCnt;
+	st->pity[0] = 0;
+	switch (b->banner) {
+	case CHAR1:
+	case CHAR2:
+	case WPN:
+		if (isGuaranteed(cfg, st, 0)) rnd = 0;
+		else if (b->banner == WPN) rnd = bits(t, 2) == 3;
+		else rnd = bits(t, 1);
+		if (rnd == 0) {
+			*isRateUp = 1;
+			st->getRateUp[0] = 0;
+			// Rate-up 4★ are characters on character banners and weapons on the weapon banner
+			st->pityS[b->banner == WPN ? 1 : 0] = 0;
+			return b->fourUp[bounded(t, b->banner == WPN ? 5 : 3)];
+		}
+		*isRateUp = 0;
+		st->getRateUp[0] = 1;
+		break;
+	case CHRONICLED:
+		*isRateUp = 1;
+		st->getRateUp[0] = 0;
+		break;
+	case NOVICE:
+		*isRateUp = 0;
+		st->getRateUp[0] = 0;
+		st->pityS[0] = 0;
+		st->pityS[1] = 0;
+		// The roll for stable pity is still made, and thrown away
+		fixed(t);
+		return b->four[bounded(t, b->fourChrCnt)];
+	default:
+		*isRateUp = 0;
+		st->getRateUp[0] = 0;
+		break;
+	}
+	rndFx = fixed(t);
+	if (cfg->doSmooth[0] >= 0) pickStable(b->banner, 4, cfg->doSmooth[0], st->pityS, rndFx, b->fourChrCnt, &min, &max);
+	return b->four[min + bounded(t, max - min)];
+}
+
+unsigned int refPull(RefState_t* st, const GachaConfig_t* cfg, const RefBanner_t* b, Tape_t* t, unsigned int* rare, unsigned int* isRateUp) {
+	unsigned long long rndFx;
+	int epitomized = cfg->doEpitomized < 0 ? (b->banner == CHRONICLED ? 1 : 2) : cfg->doEpitomized;
+	if (cfg->doPity[0]) st->pity[0]++;
+	if (cfg->doPity[1]) st->pity[1]++;
+	if (cfg->doSmooth[0] > 0) {
+		st->pityS[0]++;
+		st->pityS[1]++;
+	}
+	if (cfg->doSmooth[1] > 0) {
+		st->pityS[2]++;
+		st->pityS[3]++;
+	}
+	if (cfg->do5050 == 0) {
+		st->getRateUp[0] = 0;
+		st->getRateUp[1] = 0;
+	}
+	else if (cfg->do5050 < 0) {
+		st->getRateUp[0] = 1;
+		st->getRateUp[1] = 1;
+	}
+	if (epitomized == 0) st->fatePoints = 0;
+	rndFx = fixed(t);
+	// Without pity, the chances stay at the base rates
+	if (rndFx < thr(weight5(b->banner, cfg->doPity[1] ? st->pity[1] : 0))) {
+		*rare = 5;
+		return pull5(st, cfg, b, t, epitomized, isRateUp);
+	}
+	if (rndFx < thr(weight4(b->banner, cfg->doPity[0] ? st->pity[0] : 0))) {
+		*rare = 4;
+		return pull4(st, cfg, b, t, isRateUp);
+	}
+	*rare = 3;
+	*isRateUp = 0;
+	return b->three[bounded(t, b->threeCnt)];
+}
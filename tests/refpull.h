@@ -0,0 +1,58 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+#ifndef REFPULL_H
+#define REFPULL_H
+#include "gacha.h"
+
+// Frozen reference of doAPull, as it was before the pull kernels get any faster
+// It only shares the banner tables with src, and reads its random words from a tape instead of a generator, so that it keeps
+// giving the same results for the same tape whatever happens to gacha.c and util.c. Don't change how it behaves.
+
+// Random words, recorded from a generator as they're needed
+typedef struct {
+	unsigned long long* w;
+	size_t len;
+	size_t cap;
+	size_t pos;
+	// Reservoir for small decisions, same as in Rng_t
+	unsigned long long bits;
+	unsigned int nbits;
+	Rng_t src;
+	int failed;
+} Tape_t;
+
+// Starts a tape at the given generator state, which it copies
+int tapeInit(Tape_t*, const Rng_t*);
+void tapeFree(Tape_t*);
+// Gives the word at the given position, recording more words if needed, or 0 if out of memory (see tapeFailed)
+unsigned long long tapeWord(Tape_t*, size_t);
+int tapeFailed(const Tape_t*);
+
+typedef struct {
+	unsigned char pity[2];
+	unsigned char pityS[4];
+	unsigned char getRateUp[2];
+	unsigned char fatePoints;
+	unsigned short epitomizedPath;
+} RefState_t;
+
+typedef struct {
+	unsigned int banner;
+	unsigned short five[POOL5_MAX];
+	unsigned int fiveChrCnt;
+	unsigned int fiveWpnCnt;
+	unsigned short four[POOL4_MAX];
+	unsigned int fourChrCnt;
+	unsigned int fourWpnCnt;
+	unsigned short three[POOL3_MAX];
+	unsigned int threeCnt;
+	unsigned short fiveUp[2];
+	unsigned short fourUp[5];
+} RefBanner_t;
+
+int refPrepare(RefBanner_t*, unsigned int, unsigned int, unsigned int);
+unsigned int refPull(RefState_t*, const GachaConfig_t*, const RefBanner_t*, Tape_t*, unsigned int*, unsigned int*);
+#endif
@@ -0,0 +1,434 @@
+/* SPDX-License-Identifier: MPL-2.0 */
+/* This file is part of Yet Another Genshin Impact Wish Simulator */
+/* ©2025 Alex Pensinger (ArcticLuma113) */
+/* Released under the terms of the MPLv2, which can be viewed at https://mozilla.org/MPL/2.0/ */
+
+// Statistical regression tests for the pull kernels
+// Every scenario makes a fixed number of seeded pulls (YAGIWS_CHECK_PULLS, 10^8 by default) through doAPull_p and tallies the
+// outcome of each pull against the state it was made in. The expected chances are written out here from the published rates
+// instead of being taken from gacha.c, so a kernel that drifts from them fails even if its own tables changed with it.
+// Chances that depend on the state are checked with a chi-square sum of (observed - expected)^2 / variance over the states,
+// which holds for sequences of dependent pulls as long as each pull is independent given the state before it.
+#include "config.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "gacha.h"
+#include "util.h"
+
+#define CHECK_PULLS 100000000ull
+#define CHECK_SEED 0x59414749
+// Critical values are taken at a fixed z, about a 1 in 10^6 chance of a false failure per check
+#define CHECK_Z 4.75
+// Cells with less variance than this are left out of a chi-square sum, as the normal approximation doesn't hold there
+#define CHECK_MIN_VAR 5.0
+
+typedef struct {
+	unsigned long long pulls;
+	unsigned long long cnt[6];
+	// 5★ by 5★ pity
+	unsigned long long n5[256];
+	unsigned long long k5[256];
+	// 4★ by 4★ pity, with the expected count and its variance, as the 4★ chance also depends on the 5★ pity
+	unsigned long long k4[256];
+	double e4[256];
+	double v4[256];
+	// 5★ and 4★ on the character banners by whether they were guaranteed: lost, won, won by Capturing Radiance
+	unsigned long long split5[2][3];
+	unsigned long long split4[2][3];
+	// 5★ on banners with an Epitomized Path, by not guaranteed / guaranteed / Fate Points full: standard, other rate-up, charted item
+	unsigned long long path5[3][3];
+	// Stable pity picks for 5★ and 4★, by the pity of the type that wasn't picked last, and how often that type was picked
+	unsigned long long sN[2][256];
+	unsigned long long sK[2][256];
+	unsigned long long chr[2];
+	unsigned long long wpn[2];
+	unsigned long long fateErrors;
+} Tally_t;
+
+// Every banner type, plus the older 50/50 without Capturing Radiance, the older 2 Fate Points and the Chronicled Path
+// Banner versions are written as 0xMmp, and the path as an index into the rate-up 5★ weapons or the Chronicled 5★ pool, starting at 1.
+static const struct {
+	const char* name;
+	unsigned int banner;
+	unsigned int version;
+	unsigned int path;
+} defs[] = {
+	{"std", STD_CHR, 0x532, 0},
+	{"std_weapon", STD_WPN, 0x532, 0},
+	{"std_char", STD_ONLY_CHR, 0x532, 0},
+	{"novice", NOVICE, 0x532, 0},
+	{"char1", CHAR1, 0x532, 0},
+	{"char2", CHAR2, 0x532, 0},
+	{"char1-4.4", CHAR1, 0x441, 0},
+	{"weapon", WPN, 0x532, 1},
+	{"weapon-4.4", WPN, 0x441, 1},
+	{"chronicle", CHRONICLED, 0x532, 0},
+	{"chronicle-path", CHRONICLED, 0x532, 1},
+};
+#define SCENARIO_CNT (sizeof(defs) / sizeof(defs[0]))
+
+typedef struct {
+	const char* name;
+	unsigned int banner;
+	pthread_t thread;
+	unsigned long long seed;
+	unsigned long long pulls;
+	GachaConfig_t cfg;
+	PreparedBanner_t pb;
+	unsigned short pathItem;
+	Tally_t t;
+} Scenario_t;
+static Scenario_t scenarios[SCENARIO_CNT];
+
+static unsigned int failures = 0;
+static unsigned int checks = 0;
+
+static int isWpnBanner(unsigned int banner) {
+	return banner == WPN || banner == STD_WPN;
+}
+
+// Published pity curves: base rate, the pity where soft pity starts, and how much it adds per pull past that point
+static double chance5(unsigned int banner, unsigned int p) {
+	double h;
+	if (isWpnBanner(banner)) h = p < 63 ? 0.007 : p < 74 ? 0.007 + 0.07 * (p - 62) : 0.777 + 0.035 * (p - 73);
+	else h = p < 74 ? 0.006 : 0.006 + 0.06 * (p - 73);
+	return h > 1 ? 1 : h;
+}
+
+static double chance4(unsigned int banner, unsigned int p) {
+	double h;
+	if (isWpnBanner(banner)) h = p < 8 ? 0.06 : 0.66 + 0.3 * (p - 8);
+	else h = p < 9 ? 0.051 : 0.051 + 0.51 * (p - 8);
+	return h > 1 ? 1 : h;
+}
+
+// Stable pity: chance of getting the type that wasn't picked last, by the pulls since it was
+static double chanceStable(unsigned int banner, unsigned int rare, unsigned int p) {
+	double h;
+	if (rare == 5) h = p < 147 ? 0.003 : 0.003 + 0.03 * (p - 146);
+	else if (isWpnBanner(banner)) h = p < 15 ? 0.03 : 0.03 + 0.3 * (p - 14);
+	else h = p < 18 ? 0.0255 : 0.0255 + 0.255 * (p - 17);
+	return h > 1 ? 1 : h;
+}
+
+// Long-run 5★ and 4★ rates of the curves above, from the stationary distribution of the 4★ and 5★ pity counters
+#define RATE_PITY4 16
+#define RATE_PITY5 96
+static void consolidatedRates(unsigned int banner, double* rate5, double* rate4) {
+	static double pi[2][RATE_PITY4][RATE_PITY5];
+	double h4, h5, e;
+	unsigned int a, b, i, cur = 0;
+	memset(pi, 0, sizeof(pi));
+	pi[0][0][0] = 1;
+	for (i = 0; i < 4096; i++) {
+		memset(pi[cur ^ 1], 0, sizeof(pi[0]));
+		*rate5 = 0;
+		*rate4 = 0;
+		for (a = 0; a < RATE_PITY4 - 1; a++) {
+			for (b = 0; b < RATE_PITY5 - 1; b++) {
+				if (pi[cur][a][b] == 0) continue;
+				h5 = chance5(banner, b + 1);
+				h4 = chance4(banner, a + 1);
+				e = h4 > h5 ? h4 - h5 : 0;
+				*rate5 += pi[cur][a][b] * h5;
+				*rate4 += pi[cur][a][b] * e;
+				pi[cur ^ 1][a + 1][0] += pi[cur][a][b] * h5;
+				pi[cur ^ 1][0][b + 1] += pi[cur][a][b] * e;
+				pi[cur ^ 1][a + 1][b + 1] += pi[cur][a][b] * (1 - h5 - e);
+			}
+		}
+		cur ^= 1;
+	}
+}
+
+static int isWpn(unsigned int item) {
+	return item >= 10000;
+}
+
+// Tallies a stable pity pick, given the stable pity counters as the kernel saw them
+static void tallyStable(Tally_t* t, unsigned int r, unsigned int chrPity, unsigned int wpnPity, unsigned int item) {
+	if (chrPity <= wpnPity) {
+		t->sN[r][wpnPity]++;
+		if (isWpn(item)) t->sK[r][wpnPity]++;
+	}
+	else {
+		t->sN[r][chrPity]++;
+		if (!isWpn(item)) t->sK[r][chrPity]++;
+	}
+	if (isWpn(item)) t->wpn[r]++;
+	else t->chr[r]++;
+}
+
+static void* runScenario(void* arg) {
+	Scenario_t* s = arg;
+	Tally_t* t = &s->t;
+	GachaState_t st;
+	unsigned int rare, isRateUp, item, p4, p5, out, cls;
+	unsigned char pityS[4], rateUp[2], fate;
+	unsigned long long i;
+	double h4, h5, e;
+	initGachaState(&st);
+	rngSeed(&st.rng, RNG_XOSHIRO, s->seed);
+	st.epitomizedPath = s->pathItem;
+	for (i = 0; i < s->pulls; i++) {
+		// Counters as the kernel sees them, after startPull_p
+		p5 = (st.pity[1] + 1) & 0xff;
+		p4 = (st.pity[0] + 1) & 0xff;
+		pityS[0] = st.pityS[0] + 1;
+		pityS[1] = st.pityS[1] + 1;
+		pityS[2] = st.pityS[2] + 1;
+		pityS[3] = st.pityS[3] + 1;
+		memcpy(rateUp, st.getRateUp, sizeof(rateUp));
+		fate = st.fatePoints;
+		item = doAPull_p(&st, &s->cfg, &s->pb, &rare, &isRateUp);
+		t->cnt[rare]++;
+		h5 = chance5(s->banner, p5);
+		h4 = chance4(s->banner, p4);
+		e = h4 > h5 ? h4 - h5 : 0;
+		t->n5[p5]++;
+		t->e4[p4] += e;
+		t->v4[p4] += e * (1 - e);
+		if (rare == 5) {
+			t->k5[p5]++;
+			switch (s->banner) {
+			case CHAR1:
+			case CHAR2:
+				t->split5[rateUp[1]][isRateUp]++;
+				break;
+			case STD_CHR:
+				tallyStable(t, 0, pityS[2], pityS[3], item);
+				break;
+			case CHRONICLED:
+				if (!s->pathItem) tallyStable(t, 0, pityS[2], pityS[3], item);
+				break;
+			}
+			if (s->pathItem) {
+				cls = fate >= s->cfg.doEpitomized ? 2 : rateUp[1];
+				out = item == s->pathItem ? 2 : isRateUp ? 1 : 0;
+				t->path5[cls][out]++;
+				if (item == s->pathItem ? st.fatePoints != 0 : st.fatePoints != fate + 1 || st.fatePoints > s->cfg.doEpitomized) t->fateErrors++;
+			}
+		}
+		else if (rare == 4) {
+			t->k4[p4]++;
+			switch (s->banner) {
+			case CHAR1:
+			case CHAR2:
+			case WPN:
+				t->split4[rateUp[0]][isRateUp]++;
+				if (isRateUp) break;
+				// fallthrough
+			case STD_CHR:
+			case STD_WPN:
+			case STD_ONLY_CHR:
+			case CHRONICLED:
+				tallyStable(t, 1, pityS[0], pityS[1], item);
+				break;
+			}
+		}
+		if (rare != 5 && s->pathItem && st.fatePoints != fate) t->fateErrors++;
+	}
+	t->pulls = s->pulls;
+	return NULL;
+}
+
+static void report(const Scenario_t* s, int ok, const char* what, const char* fmt, ...) __attribute__((format(printf, 4, 5)));
+static void report(const Scenario_t* s, int ok, const char* what, const char* fmt, ...) {
+	va_list ap;
+	printf("%s: %s: %s (", ok ? "PASS" : "FAIL", s->name, what);
+	va_start(ap, fmt);
+	vprintf(fmt, ap);
+	va_end(ap);
+	printf(")\n");
+	checks++;
+	if (!ok) failures++;
+}
+
+// Upper critical value of a chi-square distribution, by the Wilson-Hilferty approximation
+static double chiCrit(unsigned int dof) {
+	double a = 2.0 / (9 * dof);
+	double c = 1 - a + CHECK_Z * sqrt(a);
+	return dof * c * c * c;
+}
+
+// Adds a cell to a chi-square sum. Cells without variance must match exactly, which is counted in *exact.
+typedef struct {
+	double chi;
+	unsigned int dof;
+	unsigned int exact;
+} Chi_t;
+
+static void chiAdd(Chi_t* c, double obs, double exp, double var) {
+	if (var < 1e-9) {
+		if (fabs(obs - exp) > 0.5) c->exact++;
+		return;
+	}
+	if (var < CHECK_MIN_VAR) return;
+	c->chi += (obs - exp) * (obs - exp) / var;
+	c->dof++;
+}
+
+static void chiReport(const Scenario_t* s, const char* what, const Chi_t* c) {
+	if (c->dof == 0 && c->exact == 0) {
+		report(s, 0, what, "no data");
+		return;
+	}
+	if (c->dof == 0) {
+		report(s, 0, what, "%u forced outcomes went wrong", c->exact);
+		return;
+	}
+	report(s, c->chi <= chiCrit(c->dof) && c->exact == 0, what, "chi2 = %.2f, %u dof, limit %.2f, %u forced outcomes wrong", c->chi, c->dof, chiCrit(c->dof), c->exact);
+}
+
+// Goodness of fit of a row of outcome counts to the given chances
+static void chiRow(Chi_t* c, const unsigned long long* obs, const double* p, unsigned int n) {
+	unsigned long long total = 0;
+	unsigned int i;
+	for (i = 0; i < n; i++) {
+		total += obs[i];
+	}
+	for (i = 0; i < n; i++) {
+		chiAdd(c, obs[i], total * p[i], total * p[i] * (1 - p[i]));
+	}
+	// The cells of a row share their total, so one of them carries no information
+	if (c->dof) c->dof--;
+}
+
+static void checkScenario(const Scenario_t* s) {
+	const Tally_t* t = &s->t;
+	unsigned int banner = s->banner;
+	unsigned int p, onset = 0, expOnset = isWpnBanner(banner) ? 63 : 74;
+	double h, var, rate, exp5, exp4, pub;
+	Chi_t c;
+	// Consolidated rates, which include soft and hard pity, within 1% of those of the curves.
+	// The 5★ rate of the curves must also be within 0.05 points of the published 1.6% (1.85% on weapon banners). Their 4★ rate
+	// falls short of the published 13% (14.5%) by a few tenths, so that one is only shown.
+	consolidatedRates(banner, &exp5, &exp4);
+	rate = (double) t->cnt[5] / t->pulls;
+	pub = isWpnBanner(banner) ? 1.85 : 1.6;
+	report(s, fabs(rate / exp5 - 1) <= 0.01 && fabs(100 * exp5 - pub) <= 0.05, "consolidated 5★ rate", "%.4f%%, expected %.4f%%, published %.2f%%", 100 * rate, 100 * exp5, pub);
+	rate = (double) t->cnt[4] / t->pulls;
+	pub = isWpnBanner(banner) ? 14.5 : 13;
+	report(s, fabs(rate / exp4 - 1) <= 0.01, "consolidated 4★ rate", "%.4f%%, expected %.4f%%, published %.1f%%", 100 * rate, 100 * exp4, pub);
+	// Chance of a 5★ and 4★ at each pity
+	memset(&c, 0, sizeof(c));
+	for (p = 1; p < 256; p++) {
+		h = chance5(banner, p);
+		chiAdd(&c, t->k5[p], t->n5[p] * h, t->n5[p] * h * (1 - h));
+	}
+	chiReport(s, "5★ chance by pity", &c);
+	memset(&c, 0, sizeof(c));
+	for (p = 1; p < 256; p++) {
+		chiAdd(&c, t->k4[p], t->e4[p], t->v4[p]);
+	}
+	chiReport(s, "4★ chance by pity", &c);
+	// Soft pity starts at the first pity where the 5★ chance is clearly above the base rate
+	h = chance5(banner, 1);
+	for (p = 1; p < 256 && !onset; p++) {
+		var = t->n5[p] * h * (1 - h);
+		if (var >= CHECK_MIN_VAR && (t->k5[p] - t->n5[p] * h) / sqrt(var) > 2 * CHECK_Z) onset = p;
+	}
+	report(s, onset == expOnset, "5★ soft pity onset", "pity %u, expected %u", onset, expOnset);
+	// 50/50 of the character banners, turned into 55/45 by Capturing Radiance, and always won when guaranteed
+	if (banner == CHAR1 || banner == CHAR2) {
+		const double lost[3] = {0.5, 0.5, 0};
+		const double radiance[3] = {0.45, 0.5, 0.05};
+		memset(&c, 0, sizeof(c));
+		chiRow(&c, t->split5[0], s->cfg.doRadiance ? radiance : lost, 3);
+		chiReport(s, s->cfg.doRadiance ? "5★ 55/45 with Capturing Radiance" : "5★ 50/50", &c);
+		report(s, t->split5[1][1] == t->split5[1][0] + t->split5[1][1] + t->split5[1][2] && t->split5[1][1], "5★ guarantee", "%llu of %llu guaranteed 5★ were rate-up",
+			t->split5[1][1], t->split5[1][0] + t->split5[1][1] + t->split5[1][2]);
+	}
+	// 4★ rate-up chance: 50/50 on character banners, 75/25 on the weapon banner
+	if (banner == CHAR1 || banner == CHAR2 || banner == WPN) {
+		const double half[3] = {0.5, 0.5, 0};
+		const double wpn[3] = {0.25, 0.75, 0};
+		memset(&c, 0, sizeof(c));
+		chiRow(&c, t->split4[0], banner == WPN ? wpn : half, 2);
+		chiReport(s, banner == WPN ? "4★ 75/25" : "4★ 50/50", &c);
+		report(s, t->split4[1][1] == t->split4[1][0] + t->split4[1][1] && t->split4[1][1], "4★ guarantee", "%llu of %llu guaranteed 4★ were rate-up",
+			t->split4[1][1], t->split4[1][0] + t->split4[1][1]);
+	}
+	// Epitomized and Chronicled Path: 75/25 (50/50 on Chronicled Wish), then the charted item once the Fate Points are full
+	if (s->pathItem) {
+		double free[3];
+		unsigned int type = isWpn(s->pathItem) ? s->pb.fiveWpnCnt : s->pb.fiveChrCnt;
+		if (banner == WPN) {
+			free[0] = 0.25;
+			free[1] = 0.375;
+			free[2] = 0.375;
+		}
+		else {
+			free[0] = 0.5 - 0.5 / type;
+			free[1] = 0;
+			free[2] = 0.5 + 0.5 / type;
+		}
+		memset(&c, 0, sizeof(c));
+		chiRow(&c, t->path5[0], free, 3);
+		chiReport(s, banner == WPN ? "5★ 75/25 and Epitomized Path" : "5★ Chronicled Path", &c);
+		if (s->cfg.doEpitomized > 1) {
+			const double guaranteed[3] = {0, 0.5, 0.5};
+			memset(&c, 0, sizeof(c));
+			chiRow(&c, t->path5[1], guaranteed, 3);
+			chiReport(s, "guaranteed 5★ split between the rate-up items", &c);
+		}
+		report(s, t->path5[2][2] == t->path5[2][0] + t->path5[2][1] + t->path5[2][2] && t->path5[2][2], "charted item at full Fate Points",
+			"%llu of %llu", t->path5[2][2], t->path5[2][0] + t->path5[2][1] + t->path5[2][2]);
+		report(s, t->fateErrors == 0, "Fate Point resets", "%llu wrong updates", t->fateErrors);
+	}
+	// Stable pity, and the character/weapon balance it gives on the standard banner
+	for (p = 0; p < 2; p++) {
+		unsigned int rare = 5 - p;
+		unsigned int q;
+		if (t->chr[p] + t->wpn[p] == 0) continue;
+		memset(&c, 0, sizeof(c));
+		for (q = 1; q < 256; q++) {
+			h = chanceStable(banner, rare, q);
+			chiAdd(&c, t->sK[p][q], t->sN[p][q] * h, t->sN[p][q] * h * (1 - h));
+		}
+		chiReport(s, rare == 5 ? "5★ stable pity" : "4★ stable pity", &c);
+		if (banner == STD_CHR) {
+			rate = (double) t->chr[p] / (t->chr[p] + t->wpn[p]);
+			report(s, fabs(rate - 0.5) <= 0.01, rare == 5 ? "5★ character/weapon balance" : "4★ character/weapon balance", "%.4f characters, expected 0.5 ± 0.01", rate);
+		}
+	}
+}
+
+int main(void) {
+	unsigned long long pulls = CHECK_PULLS;
+	const char* env = getenv("YAGIWS_CHECK_PULLS");
+	Scenario_t* s;
+	unsigned int i;
+	if (env != NULL && *env != '\0') pulls = strtoull(env, NULL, 0);
+	for (i = 0; i < SCENARIO_CNT; i++) {
+		s = &scenarios[i];
+		s->name = defs[i].name;
+		s->banner = defs[i].banner;
+		s->seed = CHECK_SEED + i;
+		s->pulls = pulls;
+		initGachaConfig(&s->cfg);
+		// Capturing Radiance as with --radiance=auto, so that it follows the banner version like the Fate Points do
+		s->cfg.doRadiance = -1;
+		resolveGachaConfig(&s->cfg, s->banner, defs[i].version);
+		if (prepareBanner(&s->pb, s->banner, getPoolIndex(s->banner, defs[i].version >> 4), getBannerIndex(s->banner, defs[i].version)) < 0) {
+			printf("ERROR: %s: unable to prepare the banner\n", s->name);
+			return 99;
+		}
+		selectKernel(&s->pb, &s->cfg);
+		if (defs[i].path) s->pathItem = s->banner == WPN ? s->pb.fiveUp[defs[i].path - 1] : s->pb.five[defs[i].path - 1];
+		if (pthread_create(&s->thread, NULL, runScenario, s) != 0) {
+			printf("ERROR: unable to start a thread\n");
+			return 99;
+		}
+	}
+	for (i = 0; i < SCENARIO_CNT; i++) {
+		pthread_join(scenarios[i].thread, NULL);
+		checkScenario(&scenarios[i]);
+	}
+	printf("%u of %u checks failed after %llu pulls per scenario\n", failures, checks, pulls);
+	return failures ? 1 : 0;
+}